@@ -0,0 +1,415 @@
+// Medivh 各阶段的基准测试：PcapReader 读取、parse_pcap 解析、epoch 切分、
+// ideal 计数、ShardedSketch 多核插入与 ResultMetrics 评估，各阶段单独计时
+//
+// 输入默认为 TraceGenerator 生成的合成 trace，参数可通过下列选项调整，
+// 其余选项交给 google benchmark 处理：
+//   --medivh_packets=<数量>   包数量，默认 1000000
+//   --medivh_flows=<数量>     候选流数量，默认 100000
+//   --medivh_snaplen=<字节>   每个包保存的字节数，默认 128
+//   --medivh_seed=<值>        随机种子，默认 1
+//   --medivh_trace=<文件>     改用已有的 pcap 文件，不再生成
+//   --medivh_dir=<目录>       生成的 trace 存放目录，默认 /tmp
+//
+// 每项结果附带 Mpps、bytes_per_second 与本项运行期间的峰值 RSS
+// （peak_rss_MiB，通过 /proc/self/clear_refs 逐项重置 VmHWM；内核不支持时
+// 改为报告进程启动以来的 cumulative_peak_rss_MiB）；
+// 使用 --benchmark_format=json 或 --benchmark_out=<文件>
+// --benchmark_out_format=json 输出 JSON，trace 参数写入 context 一并保存
+//
+// ShardedIngest/shards:N 对 1 到硬件线程数的每个分片数各测一项，
+// 用 --benchmark_filter=ShardedIngest 单独运行即得到多核扩展表；
+// Mpps 按墙钟时间计算，分片数超过物理核数后不再有意义
+
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CommandLine.h"
+#include "FlatIdeal.h"
+#include "Ideal.h"
+#include "PacketParser.h"
+#include "ResultMetrics.hpp"
+#include "ShardedSketch.hpp"
+#include "SketchReplay.hpp"
+#include "TraceGenerator.h"
+
+namespace {
+
+using Key = FiveTuple;
+using PacketVector = std::vector<PacketRecord<Key>>;
+
+struct BenchOptions {
+    BenchOptions() { trace.snap_length = 128; }
+
+    TraceConfig trace;
+    std::string trace_path;
+    std::string trace_dir = "/tmp";
+};
+
+BenchOptions options;
+
+// 文件类阶段按 trace 文件大小计字节，内存类阶段按记录数组大小计字节
+uint64_t trace_bytes = 0;
+
+// 向 clear_refs 写入 5 把 VmHWM 重置为当前 RSS（Linux 4.0 起支持）
+bool reset_peak_rss() {
+    std::FILE* file = std::fopen("/proc/self/clear_refs", "w");
+    if (!file) {
+        return false;
+    }
+    bool written = std::fputs("5", file) >= 0;
+    return std::fclose(file) == 0 && written;
+}
+
+// 读取 /proc/self/status 中的 VmHWM，失败时返回负数
+double read_peak_rss_mib() {
+    std::FILE* file = std::fopen("/proc/self/status", "r");
+    if (!file) {
+        return -1.0;
+    }
+    char line[256];
+    double peak = -1.0;
+    while (std::fgets(line, sizeof(line), file)) {
+        unsigned long long kib;
+        if (std::sscanf(line, "VmHWM: %llu kB", &kib) == 1) {
+            peak = static_cast<double>(kib) / 1024.0;
+            break;
+        }
+    }
+    std::fclose(file);
+    return peak;
+}
+
+// 启动时探测一次能否逐项重置峰值 RSS
+bool per_stage_peak_rss = false;
+
+// 每项开始时调用，放在获取共享数据之后，使共享数据的构建不计入本项峰值；
+// 本项开始时已驻留的内存（共享的记录与 ideal 等）仍包含在内
+void begin_stage() {
+    if (per_stage_peak_rss) {
+        reset_peak_rss();
+    }
+}
+
+void report(benchmark::State& state, uint64_t packets, uint64_t bytes) {
+    int64_t iterations = static_cast<int64_t>(state.iterations());
+    state.SetItemsProcessed(iterations * static_cast<int64_t>(packets));
+    state.SetBytesProcessed(iterations * static_cast<int64_t>(bytes));
+    state.counters["Mpps"] = benchmark::Counter(
+        static_cast<double>(iterations) * packets / 1e6,
+        benchmark::Counter::kIsRate);
+    double peak = per_stage_peak_rss ? read_peak_rss_mib() : -1.0;
+    if (peak >= 0) {
+        state.counters["peak_rss_MiB"] = peak;
+    } else {
+        // 进程自启动以来的最大值，包含此前各项及共享数据的占用
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        state.counters["cumulative_peak_rss_MiB"] =
+            static_cast<double>(usage.ru_maxrss) / 1024.0;
+    }
+}
+
+// 各内存类阶段共用的记录与 ideal，首次使用时构建
+const PacketVector& shared_records() {
+    static const PacketVector records =
+        PacketParser<Key>().parse_pcap(options.trace_path);
+    return records;
+}
+
+const Ideal<Key>& shared_ideal() {
+    static const std::unique_ptr<Ideal<Key>> ideal = []() {
+        std::unique_ptr<Ideal<Key>> table(new Ideal<Key>());
+        SketchReplay<Key>().replay(shared_records(), *table);
+        return table;
+    }();
+    return *ideal;
+}
+
+const FlatIdeal<Key>& shared_flat_ideal() {
+    static const std::unique_ptr<FlatIdeal<Key>> ideal = []() {
+        std::unique_ptr<FlatIdeal<Key>> table(new FlatIdeal<Key>());
+        SketchReplay<Key>().replay(shared_records(), *table);
+        return table;
+    }();
+    return *ideal;
+}
+
+void bm_pcap_reader(benchmark::State& state, bool use_mmap) {
+    uint64_t packets = 0;
+    begin_stage();
+    for (auto _ : state) {
+        PcapReader reader(options.trace_path, use_mmap);
+        if (!reader.open()) {
+            state.SkipWithError("无法打开 trace");
+            return;
+        }
+        PacketView view;
+        packets = 0;
+        uint64_t captured = 0;
+        while (reader.get_next_packet(view)) {
+            captured += view.caplen;
+            ++packets;
+        }
+        benchmark::DoNotOptimize(captured);
+    }
+    report(state, packets, trace_bytes);
+}
+
+void bm_parse_pcap(benchmark::State& state, size_t num_threads) {
+    PacketParser<Key> parser(num_threads);
+    uint64_t packets = 0;
+    begin_stage();
+    for (auto _ : state) {
+        PacketVector records = parser.parse_pcap(options.trace_path);
+        packets = records.size();
+        benchmark::DoNotOptimize(records.data());
+    }
+    report(state, packets, trace_bytes);
+}
+
+void bm_split_epochs(benchmark::State& state, std::chrono::milliseconds epoch) {
+    const PacketVector& records = shared_records();
+    size_t epochs = 0;
+    begin_stage();
+    for (auto _ : state) {
+        // split_epochs 接管记录的所有权，拷贝不计入时间
+        state.PauseTiming();
+        PacketVector copy = records;
+        state.ResumeTiming();
+        auto result = PacketParser<Key>::split_epochs(std::move(copy), epoch);
+        epochs = result.size();
+        benchmark::DoNotOptimize(epochs);
+    }
+    state.counters["epochs"] = static_cast<double>(epochs);
+    report(state, records.size(), records.size() * sizeof(records[0]));
+}
+
+template <typename IdealTable>
+void bm_build_ideal(benchmark::State& state) {
+    const PacketVector& records = shared_records();
+    size_t flows = 0;
+    begin_stage();
+    for (auto _ : state) {
+        std::unique_ptr<IdealTable> table(new IdealTable());
+        IdealTable& ideal = *table;
+        SketchReplay<Key>().replay(records, ideal);
+        flows = ideal.get_raw_data().size();
+        benchmark::DoNotOptimize(flows);
+    }
+    state.counters["flows"] = static_cast<double>(flows);
+    report(state, records.size(), records.size() * sizeof(records[0]));
+}
+
+// 逐条调用 update，与走 BatchInsertable 的 BuildIdeal/FlatIdeal 对比批量预取的收益
+void bm_build_flat_ideal_scalar(benchmark::State& state) {
+    const PacketVector& records = shared_records();
+    begin_stage();
+    for (auto _ : state) {
+        FlatIdeal<Key> ideal;
+        for (const auto& record : records) {
+            ideal.update(record.flow);
+        }
+        benchmark::DoNotOptimize(ideal.size());
+    }
+    report(state, records.size(), records.size() * sizeof(records[0]));
+}
+
+// 每个分片是一个 FlatIdeal，衡量分桶与各线程回放的总开销；
+// 各分片在计时外清空，哈希表容量保留，计时的部分不包含扩容
+void bm_sharded_ingest(benchmark::State& state, size_t shards) {
+    const PacketVector& records = shared_records();
+    ShardedSketch<Key> sketch(
+        []() {
+            return std::unique_ptr<Sketch<Key>>(new FlatIdeal<Key>());
+        },
+        shards);
+    sketch.ingest(records);
+    begin_stage();
+    for (auto _ : state) {
+        state.PauseTiming();
+        sketch.clear();
+        state.ResumeTiming();
+        sketch.ingest(records);
+    }
+    state.counters["shards"] = static_cast<double>(shards);
+    report(state, records.size(), records.size() * sizeof(records[0]));
+}
+
+// sketch 使用精确的 FlatIdeal，只衡量评估本身（遍历 ideal 与批量查询）的开销
+template <typename IdealTable>
+void bm_result_metrics(benchmark::State& state,
+                       const IdealTable& (*ideal)(),
+                       size_t num_threads) {
+    const IdealTable& table = ideal();
+    const FlatIdeal<Key>& sketch = shared_flat_ideal();
+    size_t flows = table.get_raw_data().size();
+    begin_stage();
+    for (auto _ : state) {
+        ResultMetrics<Key> metrics(table, sketch, 1000, num_threads);
+        benchmark::DoNotOptimize(metrics.get_error_metric());
+    }
+    state.counters["flows"] = static_cast<double>(flows);
+    report(state, flows, flows * sizeof(std::pair<Key, uint64_t>));
+}
+
+// 解析 --medivh_ 开头的选项并从 argv 中移除，其余留给 google benchmark；
+// 数值非法时抛出 std::runtime_error
+void parse_options(int& argc, char* argv[]) {
+    int kept = 1;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = std::strchr(arg, '=');
+        std::string name =
+            value ? std::string(arg, value - arg) : std::string(arg);
+        value = value ? value + 1 : "";
+
+        if (name == "--medivh_packets") {
+            options.trace.packet_count = parse_unsigned(value, UINT64_MAX);
+        } else if (name == "--medivh_flows") {
+            options.trace.flow_count =
+                static_cast<uint32_t>(parse_unsigned(value, UINT32_MAX));
+        } else if (name == "--medivh_snaplen") {
+            options.trace.snap_length =
+                static_cast<uint32_t>(parse_unsigned(value, UINT32_MAX));
+        } else if (name == "--medivh_seed") {
+            options.trace.seed = parse_unsigned(value, UINT64_MAX);
+        } else if (name == "--medivh_trace") {
+            options.trace_path = value;
+        } else if (name == "--medivh_dir") {
+            options.trace_dir = value;
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+}
+
+// 未指定 trace 时按参数生成，同名文件已存在则直接复用
+void prepare_trace() {
+    if (options.trace_path.empty()) {
+        const TraceConfig& trace = options.trace;
+        options.trace_path =
+            options.trace_dir + "/medivh_bench_" +
+            std::to_string(trace.packet_count) + "_" +
+            std::to_string(trace.flow_count) + "_" +
+            std::to_string(trace.snap_length) + "_" +
+            std::to_string(trace.seed) + ".pcap";
+
+        struct stat st;
+        if (stat(options.trace_path.c_str(), &st) != 0) {
+            std::fprintf(stderr, "生成 trace: %s\n",
+                         options.trace_path.c_str());
+            TraceGenerator(trace).write_pcap(options.trace_path);
+        }
+        benchmark::AddCustomContext("medivh_packets",
+                                    std::to_string(trace.packet_count));
+        benchmark::AddCustomContext("medivh_flows",
+                                    std::to_string(trace.flow_count));
+        benchmark::AddCustomContext("medivh_snaplen",
+                                    std::to_string(trace.snap_length));
+        benchmark::AddCustomContext("medivh_seed", std::to_string(trace.seed));
+    }
+    benchmark::AddCustomContext("medivh_trace", options.trace_path);
+
+    struct stat st;
+    if (stat(options.trace_path.c_str(), &st) != 0) {
+        throw std::runtime_error("无法访问 trace: " + options.trace_path);
+    }
+    trace_bytes = static_cast<uint64_t>(st.st_size);
+}
+
+// 多线程解析与评估的耗时以墙钟时间为准，速率也按墙钟时间计算
+void configure(benchmark::internal::Benchmark* bench) {
+    bench->UseRealTime()->Unit(benchmark::kMillisecond);
+}
+
+void register_benchmarks() {
+    std::vector<size_t> thread_counts = {1};
+    size_t hardware = std::thread::hardware_concurrency();
+    if (hardware > 1) {
+        thread_counts.push_back(hardware);
+    }
+
+    configure(benchmark::RegisterBenchmark("PcapReader/stream",
+                                           bm_pcap_reader, false));
+    configure(
+        benchmark::RegisterBenchmark("PcapReader/mmap", bm_pcap_reader, true));
+
+    for (size_t threads : thread_counts) {
+        std::string name = "ParsePcap/threads:" + std::to_string(threads);
+        configure(
+            benchmark::RegisterBenchmark(name.c_str(), bm_parse_pcap, threads));
+    }
+
+    for (int epoch_ms : {1, 10, 100}) {
+        std::string name = "SplitEpochs/epoch_ms:" + std::to_string(epoch_ms);
+        configure(benchmark::RegisterBenchmark(name.c_str(), bm_split_epochs,
+                                               std::chrono::milliseconds(
+                                                   epoch_ms)));
+    }
+
+    configure(benchmark::RegisterBenchmark("BuildIdeal/Ideal",
+                                           bm_build_ideal<Ideal<Key>>));
+    configure(benchmark::RegisterBenchmark("BuildIdeal/FlatIdeal",
+                                           bm_build_ideal<FlatIdeal<Key>>));
+    configure(benchmark::RegisterBenchmark("BuildIdeal/FlatIdeal_scalar",
+                                           bm_build_flat_ideal_scalar));
+
+    for (size_t shards = 1; shards <= std::max<size_t>(hardware, 1);
+         ++shards) {
+        std::string name = "ShardedIngest/shards:" + std::to_string(shards);
+        configure(benchmark::RegisterBenchmark(name.c_str(),
+                                               bm_sharded_ingest, shards));
+    }
+
+    for (size_t threads : thread_counts) {
+        std::string suffix = "/threads:" + std::to_string(threads);
+        configure(benchmark::RegisterBenchmark(
+            ("ResultMetrics/Ideal" + suffix).c_str(),
+            bm_result_metrics<Ideal<Key>>, &shared_ideal, threads));
+        configure(benchmark::RegisterBenchmark(
+            ("ResultMetrics/FlatIdeal" + suffix).c_str(),
+            bm_result_metrics<FlatIdeal<Key>>, &shared_flat_ideal, threads));
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        parse_options(argc, argv);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "错误: %s\n", e.what());
+        return 1;
+    }
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+
+    try {
+        prepare_trace();
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "错误: %s\n", e.what());
+        return 1;
+    }
+
+    per_stage_peak_rss = reset_peak_rss() && read_peak_rss_mib() >= 0;
+    register_benchmarks();
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
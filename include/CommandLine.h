@@ -0,0 +1,33 @@
+#ifndef COMMAND_LINE_H
+#define COMMAND_LINE_H
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+// 命令行工具共用的参数解析，非法输入抛出 std::runtime_error
+
+// 十进制无符号整数；拒绝空串、尾随字符、负号、溢出与超过 max_value 的值
+inline uint64_t parse_unsigned(const char* text, uint64_t max_value) {
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long value = std::strtoull(text, &end, 10);
+    if (errno != 0 || end == text || *end != '\0' || text[0] == '-' ||
+        value > max_value) {
+        throw std::runtime_error(std::string("非法的整数参数: ") + text);
+    }
+    return value;
+}
+
+inline double parse_double(const char* text) {
+    char* end = nullptr;
+    double value = std::strtod(text, &end);
+    if (end == text || *end != '\0') {
+        throw std::runtime_error(std::string("非法的数值参数: ") + text);
+    }
+    return value;
+}
+
+#endif
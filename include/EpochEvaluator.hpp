@@ -0,0 +1,182 @@
+#ifndef EPOCH_EVALUATOR_HPP
+#define EPOCH_EVALUATOR_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "Ideal.h"
+#include "PacketParser.h"
+#include "ResultMetrics.hpp"
+#include "Sketch.h"
+#include "SketchReplay.hpp"
+
+// 按 epoch 评估 sketch 精度，输出每个时间窗口的指标序列
+// ideal 与 sketch 在窗口之间调用 clear() 原地复位，整个过程复用同一对对象，
+// 不需要为每个 epoch 重新构造
+template <typename FlowKeyType, typename SFINAE = RequireFlowKey<FlowKeyType>>
+class EpochEvaluator {
+   public:
+    using PacketRecordType = PacketRecord<FlowKeyType>;
+    using PacketVector = std::vector<PacketRecordType>;
+    using EpochVector = EpochPackets<FlowKeyType>;
+    using EpochView = RecordSpan<PacketRecordType>;
+    using Stream = typename PacketParser<FlowKeyType>::Stream;
+    using MetricsType = ResultMetrics<FlowKeyType>;
+
+    // 单个 epoch 的评估结果
+    struct EpochResult {
+        size_t index;                               // 非空 epoch 的序号
+        std::chrono::nanoseconds first_timestamp;   // 窗口内最早的记录
+        std::chrono::nanoseconds last_timestamp;    // 窗口内最晚的记录
+        uint64_t packets;
+        uint64_t bytes;
+        double replay_seconds;  // sketch 回放耗时，不含 ideal
+        MetricsType metrics;
+    };
+
+    using EpochCallback = std::function<void(const EpochResult&)>;
+
+    // num_threads 传给每个 epoch 的 ResultMetrics，0 表示使用全部硬件线程
+    EpochEvaluator(Ideal<FlowKeyType>& ideal,
+                   Sketch<FlowKeyType>& sketch,
+                   uint64_t hh_threshold,
+                   CountMode mode = CountMode::PACKETS,
+                   size_t num_threads = 1)
+        : ideal_(ideal),
+          sketch_(sketch),
+          hh_threshold_(hh_threshold),
+          count_mode_(mode),
+          num_threads_(num_threads),
+          replay_(mode) {}
+
+    // 每完成一个 epoch 调用一次，可用于边评估边输出
+    void set_epoch_callback(EpochCallback callback) {
+        callback_ = std::move(callback);
+    }
+
+    const std::vector<EpochResult>& get_results() const { return results_; }
+
+    void clear_results() { results_.clear(); }
+
+    // 评估已切分好的 epoch，例如 parse_pcap_with_epochs 的结果
+    const std::vector<EpochResult>& run(const EpochVector& epochs) {
+        for (const auto& packets : epochs) {
+            begin_epoch();
+            feed(packets);
+            end_epoch();
+        }
+        return results_;
+    }
+
+    // 流式评估：边读边按时间窗口切分，内存占用只与批大小有关
+    // 窗口划分与 split_epochs 一致，以第一条记录为起点、长度为 epoch；
+    // 文件中时间戳回退的记录计入当前窗口。epoch 为 0 时整个流作为一个窗口
+    const std::vector<EpochResult>& run(Stream& stream,
+                                        std::chrono::nanoseconds epoch) {
+        PacketVector batch;
+        bool started = false;
+        std::chrono::nanoseconds start_time{0};
+        std::chrono::nanoseconds epoch_end{0};
+
+        while (stream.next_batch(batch)) {
+            const PacketRecordType* first = batch.data();
+            const PacketRecordType* last = batch.data() + batch.size();
+
+            while (first != last) {
+                if (!started) {
+                    start_time = first->timestamp;
+                    epoch_end = start_time + epoch;
+                    started = true;
+                    begin_epoch();
+                } else if (epoch.count() > 0 &&
+                           first->timestamp >= epoch_end) {
+                    end_epoch();
+                    auto index = (first->timestamp - start_time) / epoch;
+                    epoch_end = start_time + (index + 1) * epoch;
+                    begin_epoch();
+                }
+
+                // 找出当前窗口内连续的一段，整段交给回放
+                const PacketRecordType* cut = first + 1;
+                if (epoch.count() > 0) {
+                    while (cut != last && cut->timestamp < epoch_end) {
+                        ++cut;
+                    }
+                } else {
+                    cut = last;
+                }
+                feed(EpochView(first, cut));
+                first = cut;
+            }
+        }
+
+        if (started) {
+            end_epoch();
+        }
+        return results_;
+    }
+
+   private:
+    Ideal<FlowKeyType>& ideal_;
+    Sketch<FlowKeyType>& sketch_;
+    uint64_t hh_threshold_;
+    CountMode count_mode_;
+    size_t num_threads_;
+    SketchReplay<FlowKeyType> replay_;
+    EpochCallback callback_;
+    std::vector<EpochResult> results_;
+
+    // 当前 epoch 的累计量
+    uint64_t packets_ = 0;
+    uint64_t bytes_ = 0;
+    double replay_seconds_ = 0.0;
+    std::chrono::nanoseconds first_timestamp_{0};
+    std::chrono::nanoseconds last_timestamp_{0};
+
+    void begin_epoch() {
+        ideal_.clear();
+        sketch_.clear();
+        packets_ = 0;
+        bytes_ = 0;
+        replay_seconds_ = 0.0;
+    }
+
+    void feed(const EpochView& packets) {
+        if (packets.size() == 0) {
+            return;
+        }
+        for (const auto& record : packets) {
+            if (packets_ == 0) {
+                first_timestamp_ = record.timestamp;
+                last_timestamp_ = record.timestamp;
+            } else {
+                first_timestamp_ = std::min(first_timestamp_, record.timestamp);
+                last_timestamp_ = std::max(last_timestamp_, record.timestamp);
+            }
+            packets_++;
+            bytes_ += record.length;
+        }
+
+        replay_.replay(packets, ideal_);
+        replay_seconds_ += replay_.replay(packets, sketch_).seconds;
+    }
+
+    void end_epoch() {
+        if (packets_ == 0) {
+            return;
+        }
+        results_.push_back(EpochResult{
+            results_.size(), first_timestamp_, last_timestamp_, packets_,
+            bytes_, replay_seconds_,
+            MetricsType(ideal_, sketch_, hh_threshold_, num_threads_)});
+        if (callback_) {
+            callback_(results_.back());
+        }
+    }
+};
+
+#endif  // EPOCH_EVALUATOR_HPP
@@ -0,0 +1,139 @@
+#ifndef FLAT_IDEAL_H
+#define FLAT_IDEAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "Sketch.h"
+#include "SketchExtensions.h"
+
+// 开放寻址的精确计数表，作为 Ideal 的紧凑替代
+// key 与计数内联存放在一段连续数组中，线性探测，容量为 2 的幂；
+// 每条流约占 sizeof(pair<key, uint64_t>) / 负载率 字节，遍历即顺序扫描数组；
+// 批量更新与批量查询时先算出一段 key 的起始槽位并预取，再依次探测
+template <typename FlowKeyType, typename SFINAE = RequireFlowKey<FlowKeyType>>
+class FlatIdeal : public Sketch<FlowKeyType>,
+                  public BatchInsertable<FlowKeyType>,
+                  public BatchQueryable<FlowKeyType> {
+   public:
+    using Entry = std::pair<FlowKeyType, uint64_t>;
+
+    // 只读遍历已占用的槽位，接口与 Ideal::get_raw_data 返回的容器一致，
+    // 元素的 first 为流、second 为计数
+    class RawData {
+       public:
+        using value_type = Entry;
+
+        class const_iterator {
+           public:
+            const_iterator(const RawData* data, size_t index)
+                : data_(data), index_(index) {
+                skip_empty();
+            }
+
+            const Entry& operator*() const { return data_->slots_[index_]; }
+            const Entry* operator->() const { return &data_->slots_[index_]; }
+
+            const_iterator& operator++() {
+                ++index_;
+                skip_empty();
+                return *this;
+            }
+
+            bool operator==(const const_iterator& other) const {
+                return index_ == other.index_;
+            }
+            bool operator!=(const const_iterator& other) const {
+                return index_ != other.index_;
+            }
+
+           private:
+            const RawData* data_;
+            size_t index_;
+
+            void skip_empty() {
+                while (index_ < data_->used_.size() && !data_->used_[index_]) {
+                    ++index_;
+                }
+            }
+        };
+
+        RawData(const std::vector<Entry>& slots,
+                const std::vector<uint8_t>& used,
+                size_t size)
+            : slots_(slots), used_(used), size_(size) {}
+
+        const_iterator begin() const { return const_iterator(this, 0); }
+        const_iterator end() const {
+            return const_iterator(this, used_.size());
+        }
+        size_t size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+
+        // 按槽位区间切分遍历：at_slot(i) 指向槽位 i 及之后的第一个流，
+        // [at_slot(a), at_slot(b)) 恰好覆盖槽位 [a, b) 中的流
+        size_t slot_count() const { return used_.size(); }
+        const_iterator at_slot(size_t slot) const {
+            return const_iterator(this, slot);
+        }
+
+       private:
+        const std::vector<Entry>& slots_;
+        const std::vector<uint8_t>& used_;
+        size_t size_;
+    };
+
+    // expected_flows 为预计的不同流数，不知道时取 0，超出后按两倍扩容；
+    // 不要按包数预分配，表会大出数倍，遍历时也要扫过全部槽位
+    explicit FlatIdeal(size_t expected_flows = 0);
+
+    // 计数不小于 0：负增量最多把已有流减到 0，对不存在的流不生效
+    void update(const FlowKeyType& flow, int increment = 1) override;
+    void update_batch(const FlowKeyType* keys,
+                      const int* increments,
+                      size_t count) override;
+    uint64_t query(const FlowKeyType& flow) const override;
+    void query_batch(const FlowKeyType* keys,
+                     size_t count,
+                     uint64_t* estimates) const override;
+    // 清空计数但保留容量，按 epoch 复用时不重新分配
+    void clear() override;
+
+    void reserve(size_t flows);
+    size_t size() const { return size_; }
+    size_t capacity() const { return slots_.size(); }
+
+    RawData get_raw_data() const { return RawData(slots_, used_, size_); }
+
+   private:
+    // 负载率上限为 MAX_LOAD_NUMERATOR / MAX_LOAD_DENOMINATOR
+    static constexpr size_t MAX_LOAD_NUMERATOR = 7;
+    static constexpr size_t MAX_LOAD_DENOMINATOR = 10;
+    static constexpr size_t MIN_CAPACITY = 16;
+    // 批量接口每次预取的 key 数，足以覆盖访存延迟又不至于让预取的行被挤出
+    static constexpr size_t PREFETCH_STRIDE = 16;
+
+    std::vector<Entry> slots_;
+    std::vector<uint8_t> used_;
+    size_t size_;
+    size_t mask_;
+
+    size_t home_slot(const FlowKeyType& flow) const {
+        uint64_t h = static_cast<uint64_t>(std::hash<FlowKeyType>{}(flow));
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return static_cast<size_t>(h) & mask_;
+    }
+
+    // 从 index 开始探测并累加 flow 的计数，index 须为 flow 的起始槽位
+    void add(const FlowKeyType& flow, int increment, size_t index);
+    // 从起始槽位 index 开始探测 flow 的计数，不存在时返回 0
+    uint64_t find(const FlowKeyType& flow, size_t index) const;
+    void rehash(size_t capacity);
+};
+
+#endif
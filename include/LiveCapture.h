@@ -0,0 +1,109 @@
+#ifndef LIVE_CAPTURE_H
+#define LIVE_CAPTURE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "PacketParser.h"
+#include "SpscRing.h"
+
+// 网卡实时抓包，基于 Linux AF_PACKET 原始套接字，不依赖 libpcap
+// 时间戳取内核收包时间；回环等接口上本机发出的包默认不计入，避免重复
+class LiveSource {
+   public:
+    explicit LiveSource(const std::string& interface,
+                        bool promiscuous = false,
+                        bool capture_outgoing = false);
+    ~LiveSource();
+
+    LiveSource(const LiveSource&) = delete;
+    LiveSource& operator=(const LiveSource&) = delete;
+
+    // 接口不存在、链路层类型不支持或缺少 CAP_NET_RAW 权限时返回 false
+    bool open();
+    // 最多等待 timeout_ms 毫秒，超时返回 false；读取出错时抛出异常
+    bool get_next_packet(PacketView& view, int timeout_ms);
+    void close();
+
+    pcpp::LinkLayerType get_link_type() const { return link_type_; }
+
+   private:
+    std::string interface_;
+    bool promiscuous_;
+    bool capture_outgoing_;
+    int fd_;
+    pcpp::LinkLayerType link_type_;
+    std::vector<uint8_t> buffer_;
+};
+
+// 实时采集流水线：采集线程读包并提取 FlowKey，攒满一批后经 SPSC 环形队列
+// 交给消费线程（通常是 sketch 回放线程）。用过的批次经另一条队列还给
+// 采集线程复用，稳定运行时不再分配内存
+template <typename FlowKeyType, typename SFINAE = RequireFlowKey<FlowKeyType>>
+class LiveIngest {
+   public:
+    using PacketRecordType = PacketRecord<FlowKeyType>;
+    using PacketVector = std::vector<PacketRecordType>;
+
+    static constexpr size_t DEFAULT_BATCH_SIZE = 4096;
+    static constexpr size_t DEFAULT_RING_CAPACITY = 64;
+
+    struct Stats {
+        uint64_t packets = 0;          // 收到的包
+        uint64_t records = 0;          // 提取出 FlowKey 的包
+        uint64_t dropped_batches = 0;  // 队列满时丢弃的批次
+        uint64_t dropped_records = 0;
+    };
+
+    // source 需已成功 open
+    explicit LiveIngest(std::unique_ptr<LiveSource> source,
+                        size_t batch_size = DEFAULT_BATCH_SIZE,
+                        size_t ring_capacity = DEFAULT_RING_CAPACITY);
+    ~LiveIngest();
+
+    LiveIngest(const LiveIngest&) = delete;
+    LiveIngest& operator=(const LiveIngest&) = delete;
+
+    // 启动采集线程；flush_interval 内没有攒满一批时也会把已有记录交出去，
+    // 低速流量下消费端延迟有上界
+    void start(std::chrono::milliseconds flush_interval =
+                   std::chrono::milliseconds{100});
+    // 停止采集，尚未交出的记录在停止前交出；队列已满时最多等待一个
+    // flush_interval，仍放不下的记录计入 dropped_batches / dropped_records
+    void stop();
+
+    // 仅由一个消费线程调用。用下一批记录替换 batch 的内容，
+    // 超时或采集已停止且队列为空时返回 false；采集线程出错时在此重新抛出
+    bool next_batch(PacketVector& batch, std::chrono::milliseconds timeout);
+
+    // 采集线程因读取出错退出后也返回 false
+    bool is_running() const { return running_.load(); }
+    Stats get_stats() const;
+
+   private:
+    std::unique_ptr<LiveSource> source_;
+    size_t batch_size_;
+    SpscRing<PacketVector> ready_;   // 采集线程 -> 消费线程
+    SpscRing<PacketVector> recycle_;  // 消费线程 -> 采集线程
+    std::thread thread_;
+    std::atomic<bool> running_;
+    std::atomic<bool> finished_;
+    // 采集线程遇到的错误，在 finished_ 置位前写入
+    std::exception_ptr error_;
+
+    std::atomic<uint64_t> packets_;
+    std::atomic<uint64_t> records_;
+    std::atomic<uint64_t> dropped_batches_;
+    std::atomic<uint64_t> dropped_records_;
+
+    void capture_loop(std::chrono::milliseconds flush_interval);
+    void publish(PacketVector& batch);
+};
+
+#endif
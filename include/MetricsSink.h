@@ -0,0 +1,69 @@
+#ifndef METRICS_SINK_H
+#define METRICS_SINK_H
+
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 面向批量实验的指标输出，只追加写入
+// 列在构造时固定：若干字符串标签列（配置名、epoch 等）加若干数值列。
+// 每行在调用线程中格式化，加锁后只做一次缓冲区追加，缓冲区满了才写文件，
+// 可被多个工作线程同时调用
+class MetricsSink {
+   public:
+    enum class Format { CSV, JSON_LINES };
+
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 1 << 16;
+
+    // 文件以追加方式打开；CSV 文件为空时先写表头。打开失败时抛出异常
+    MetricsSink(const std::string& path,
+                Format format,
+                std::vector<std::string> label_columns,
+                std::vector<std::string> value_columns,
+                size_t buffer_size = DEFAULT_BUFFER_SIZE);
+    ~MetricsSink();
+
+    MetricsSink(const MetricsSink&) = delete;
+    MetricsSink& operator=(const MetricsSink&) = delete;
+
+    // 按扩展名选择格式：.jsonl / .json 为 JSON lines，其余为 CSV
+    static Format format_from_path(const std::string& path);
+
+    // labels 与 values 的数量必须和对应的列数一致
+    // 非有限值（NaN 表示该指标缺失）在 CSV 中留空，在 JSON 中写为 null
+    void write(const std::vector<std::string>& labels,
+               const std::vector<double>& values);
+    void write(const std::vector<std::string>& labels, const double* values);
+
+    // 写入失败时抛出异常
+    void flush();
+
+    const std::vector<std::string>& get_label_columns() const {
+        return label_columns_;
+    }
+    const std::vector<std::string>& get_value_columns() const {
+        return value_columns_;
+    }
+
+   private:
+    std::FILE* file_;
+    Format format_;
+    std::vector<std::string> label_columns_;
+    std::vector<std::string> value_columns_;
+    size_t buffer_size_;
+
+    std::mutex mutex_;
+    std::string buffer_;
+
+    void format_csv(const std::vector<std::string>& labels,
+                    const double* values,
+                    std::string& line) const;
+    void format_json(const std::vector<std::string>& labels,
+                     const double* values,
+                     std::string& line) const;
+    // 调用方需持有 mutex_，写入失败时返回 false
+    bool flush_locked();
+};
+
+#endif
@@ -6,15 +6,19 @@
 #include <cstdint>
 #include <cstring>
 #include <fstream>
+#include <limits>
+#include <memory>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "FlowKey.h"
 #include "IPv4Layer.h"
 #include "Packet.h"
 #include "TcpLayer.h"
+#include "TraceInput.h"
 #include "UdpLayer.h"
 
 // 辅助函数
@@ -32,10 +36,48 @@ inline uint32_t swap_bytes32(uint32_t val) {
            ((val & 0x00FF0000) >> 8) | ((val & 0xFF000000) >> 24);
 }
 
-// Pcap文件读取器
+// 把 16 字节 IPv6 地址折叠为 32 位，使 IPv6 流复用现有的 FlowKey 类型
+// 结果与 IPv4 地址一样按网络字节序存放，落在 240.0.0.0/4
+// （IPv4 保留地址段，实际流量中不会出现），
+// IPv6 流不会与 IPv4 流合并；但 n 个不同的 IPv6 地址之间
+// 预计有约 n^2 / 2^29 对折叠到同一值（10^4 个约 0.2 对，10^5 个约 19 对），
+// 这些地址的流在 ideal 中会被合并，解析器通过 get_ipv6_records 报告涉及的记录数
+constexpr uint32_t FOLDED_IPV6_PREFIX = 0xf0000000u;
+
+inline uint32_t fold_ipv6_address(const uint8_t* addr) {
+    uint64_t hi, lo;
+    std::memcpy(&hi, addr, sizeof(hi));
+    std::memcpy(&lo, addr + sizeof(hi), sizeof(lo));
+    uint64_t h = (hi * 0x9E3779B97F4A7C15ULL) ^ lo;
+    h *= 0xC2B2AE3D27D4EB4FULL;
+    uint32_t folded = FOLDED_IPV6_PREFIX | static_cast<uint32_t>(h >> 36);
+    uint8_t bytes[4] = {static_cast<uint8_t>(folded >> 24),
+                        static_cast<uint8_t>(folded >> 16),
+                        static_cast<uint8_t>(folded >> 8),
+                        static_cast<uint8_t>(folded)};
+    uint32_t raw;
+    std::memcpy(&raw, bytes, sizeof(raw));
+    return raw;
+}
+
+// 数据包视图，data 指向映射文件或读取器内部缓冲区，不拥有数据
+// 仅在下一次 get_next_packet 调用之前有效
+struct PacketView {
+    const uint8_t* data = nullptr;
+    uint32_t caplen = 0;  // 实际捕获长度
+    uint32_t len = 0;     // 原始报文长度
+    std::chrono::nanoseconds timestamp{0};
+    // pcapng 中不同接口的链路层类型可以不同，按包记录
+    pcpp::LinkLayerType link_type = pcpp::LINKTYPE_ETHERNET;
+};
+
+// Pcap文件读取器，支持 libpcap 与 pcapng 格式，以及两者的 gzip / zstd 压缩
 class PcapReader {
    public:
-    explicit PcapReader(const std::string& filename);
+    // use_mmap 为 true 且目标是未压缩的 libpcap 普通文件时，整个文件映射进
+    // 内存，数据包视图直接指向映射区域，无逐包分配和拷贝；
+    // pcapng 与压缩文件总是流式读取
+    explicit PcapReader(const std::string& filename, bool use_mmap = false);
     ~PcapReader();
 
     PcapReader(const PcapReader&) = delete;
@@ -43,21 +85,271 @@ class PcapReader {
 
     bool open();
     bool get_next_packet(pcpp::RawPacket& raw_packet);
+    bool get_next_packet(PacketView& view);
     void close();
 
+    bool is_mapped() const { return mapped_data_ != nullptr; }
+    bool is_pcapng() const { return is_pcapng_; }
+    // pcapng 文件返回第一个接口的链路层类型，逐包的类型见 PacketView
+    pcpp::LinkLayerType get_link_type() const { return link_type_; }
+    // pcapng 简单包块（SPB）不带时间戳，沿用本节中上一个包的时间戳，
+    // 使按时间排序与 epoch 切分时仍留在原位置；本节还没有带时间戳的包时
+    // 无从推断，跳过并计入此处
+    uint64_t get_untimed_packets() const { return untimed_packets_; }
+
+    // 以下接口仅在 mmap 模式下可用，不修改读取器状态，可被多个线程并发调用
+    // 沿记录头扫描，把数据区切分为约 chunk_count 块，返回各块起始偏移，
+    // 末尾附加文件结束偏移
+    std::vector<size_t> split_chunks(size_t chunk_count) const;
+    // 读取 [offset, end) 中的下一条记录并推进 offset
+    bool get_packet_at(size_t& offset, size_t end, PacketView& view) const;
+
+    // 归还已读过的映射页，顺序流式读取时保持常驻内存有界
+    void release_consumed();
+
    private:
+    // pcapng 接口描述块中与解析相关的字段
+    struct PcapngInterface {
+        pcpp::LinkLayerType link_type;
+        bool binary_resolution;  // if_tsresol 最高位：时间单位为 2^-n 秒
+        uint8_t resolution;      // 时间单位的指数，默认 10^-6 秒
+        int64_t offset_seconds;  // if_tsoffset
+    };
+
+    bool map_file();
+    void unmap_file();
+    bool read_header(void* dst, size_t size);
+
+    // pcapng：fields 为节头块的长度与字节序魔数，据此确定本节字节序
+    // 并跳过节头块余下部分
+    bool read_section_header(const uint8_t* fields);
+    bool get_next_pcapng_packet(PacketView& view);
+    void add_pcapng_interface(const uint8_t* body, size_t size);
+
     std::string filename_;
-    std::ifstream file_;
-    bool is_big_endian_;
+    std::unique_ptr<TraceInput> input_;
+    bool use_mmap_;
+    bool is_pcapng_;
+    bool is_big_endian_;  // 文件字节序与本机相反
     bool has_nano_precision_;
     pcpp::LinkLayerType link_type_;
+    std::vector<PcapngInterface> interfaces_;
+    // 本节上一个带时间戳的包，供简单包块沿用
+    bool has_last_timestamp_;
+    std::chrono::nanoseconds last_timestamp_;
+    uint64_t untimed_packets_;
+
+    // mmap 模式
+    const uint8_t* mapped_data_;
+    size_t mapped_size_;
+    size_t offset_;
+    size_t released_;  // 已归还给内核的映射前缀长度
+
+    // 流模式下复用的数据缓冲区
+    std::vector<uint8_t> buffer_;
 };
 
+// 统计口径：按包数或按字节数计数
+enum class CountMode { PACKETS, BYTES };
+
+// 长度为 length 的报文在给定口径下的计数增量
+// Sketch::update 的增量为 int，超长的包长截断到 int 上限
+inline int count_weight(CountMode mode, uint32_t length) {
+    if (mode == CountMode::PACKETS) {
+        return 1;
+    }
+    return static_cast<int>(std::min<uint32_t>(
+        length, static_cast<uint32_t>(std::numeric_limits<int>::max())));
+}
+
 // 数据包记录模板
+// length 放在 timestamp 之前以填入 flow 之后的对齐空隙，
+// PacketRecord<OneTuple> 保持 16 字节；构造函数保留 {flow, timestamp}
+// 的初始化写法，length 作为可选的第三个参数
 template <typename FlowKeyType>
 struct PacketRecord {
     FlowKeyType flow;
+    uint32_t length = 0;  // 原始报文长度，取自 pcap 记录头的 orig_len
     std::chrono::nanoseconds timestamp;
+
+    PacketRecord() = default;
+    PacketRecord(const FlowKeyType& flow,
+                 std::chrono::nanoseconds timestamp,
+                 uint32_t length = 0)
+        : flow(flow), length(length), timestamp(timestamp) {}
+
+    // 该记录在给定口径下的计数增量
+    int weight(CountMode mode) const { return count_weight(mode, length); }
+};
+
+// 连续记录区间的只读视图，不拥有数据
+template <typename RecordType>
+class RecordSpan {
+   public:
+    using const_iterator = const RecordType*;
+
+    RecordSpan() : first_(nullptr), last_(nullptr) {}
+    RecordSpan(const RecordType* first, const RecordType* last)
+        : first_(first), last_(last) {}
+
+    const_iterator begin() const { return first_; }
+    const_iterator end() const { return last_; }
+    size_t size() const { return static_cast<size_t>(last_ - first_); }
+    bool empty() const { return first_ == last_; }
+
+    const RecordType& operator[](size_t i) const { return first_[i]; }
+    const RecordType& front() const { return *first_; }
+    const RecordType& back() const { return *(last_ - 1); }
+
+   private:
+    const RecordType* first_;
+    const RecordType* last_;
+};
+
+// 按 epoch 切分的记录：所有记录存放在同一块连续缓冲区中，
+// 每个 epoch 只是其中的一段 [bounds[i], bounds[i + 1]) 区间
+template <typename FlowKeyType>
+class EpochPackets {
+   public:
+    using PacketRecordType = PacketRecord<FlowKeyType>;
+    using PacketVector = std::vector<PacketRecordType>;
+    using EpochView = RecordSpan<PacketRecordType>;
+
+    class const_iterator {
+       public:
+        const_iterator(const EpochPackets* owner, size_t index)
+            : owner_(owner), index_(index) {}
+
+        EpochView operator*() const { return (*owner_)[index_]; }
+        const_iterator& operator++() {
+            ++index_;
+            return *this;
+        }
+        bool operator==(const const_iterator& other) const {
+            return index_ == other.index_;
+        }
+        bool operator!=(const const_iterator& other) const {
+            return index_ != other.index_;
+        }
+
+       private:
+        const EpochPackets* owner_;
+        size_t index_;
+    };
+
+    EpochPackets() = default;
+    EpochPackets(PacketVector packets, std::vector<size_t> bounds)
+        : packets_(std::move(packets)), bounds_(std::move(bounds)) {}
+
+    size_t size() const { return bounds_.empty() ? 0 : bounds_.size() - 1; }
+    bool empty() const { return size() == 0; }
+
+    EpochView operator[](size_t i) const {
+        const PacketRecordType* base = packets_.data();
+        return EpochView(base + bounds_[i], base + bounds_[i + 1]);
+    }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+
+    // 底层连续缓冲区
+    const PacketVector& packets() const { return packets_; }
+    const std::vector<size_t>& bounds() const { return bounds_; }
+
+   private:
+    PacketVector packets_;
+    std::vector<size_t> bounds_;
+};
+
+// 列式存储的记录：key、时间戳、报文长度各自连续存放，
+// 只需要 key 的回放循环可以只遍历 keys() 一列
+template <typename FlowKeyType>
+class PacketColumns {
+   public:
+    explicit PacketColumns(bool with_lengths = false)
+        : with_lengths_(with_lengths) {}
+
+    size_t size() const { return keys_.size(); }
+    bool empty() const { return keys_.empty(); }
+    bool has_lengths() const { return with_lengths_; }
+
+    void reserve(size_t count) {
+        keys_.reserve(count);
+        timestamps_.reserve(count);
+        if (with_lengths_) {
+            lengths_.reserve(count);
+        }
+    }
+
+    void push_back(const FlowKeyType& flow,
+                   std::chrono::nanoseconds timestamp,
+                   uint32_t length) {
+        keys_.push_back(flow);
+        timestamps_.push_back(timestamp);
+        if (with_lengths_) {
+            lengths_.push_back(length);
+        }
+    }
+
+    // 追加另一组同配置的列，other 随后被清空
+    void append(PacketColumns&& other) {
+        append_column(keys_, other.keys_);
+        append_column(timestamps_, other.timestamps_);
+        append_column(lengths_, other.lengths_);
+    }
+
+    // 按时间戳稳定排序，各列同步重排
+    void sort_by_timestamp() {
+        if (std::is_sorted(timestamps_.begin(), timestamps_.end())) {
+            return;
+        }
+
+        std::vector<size_t> order(size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(),
+                         [this](size_t a, size_t b) {
+                             return timestamps_[a] < timestamps_[b];
+                         });
+
+        permute(keys_, order);
+        permute(timestamps_, order);
+        permute(lengths_, order);
+    }
+
+    const std::vector<FlowKeyType>& keys() const { return keys_; }
+    const std::vector<std::chrono::nanoseconds>& timestamps() const {
+        return timestamps_;
+    }
+    // 未启用长度列时为空
+    const std::vector<uint32_t>& lengths() const { return lengths_; }
+
+   private:
+    template <typename T>
+    static void append_column(std::vector<T>& dst, std::vector<T>& src) {
+        dst.insert(dst.end(), src.begin(), src.end());
+        std::vector<T>().swap(src);
+    }
+
+    template <typename T>
+    static void permute(std::vector<T>& column,
+                        const std::vector<size_t>& order) {
+        if (column.empty()) {
+            return;
+        }
+        std::vector<T> sorted;
+        sorted.reserve(column.size());
+        for (size_t index : order) {
+            sorted.push_back(column[index]);
+        }
+        column.swap(sorted);
+    }
+
+    bool with_lengths_;
+    std::vector<FlowKeyType> keys_;
+    std::vector<std::chrono::nanoseconds> timestamps_;
+    std::vector<uint32_t> lengths_;
 };
 
 // PacketParser模板
@@ -66,14 +358,138 @@ class PacketParser {
    public:
     using PacketRecordType = PacketRecord<FlowKeyType>;
     using PacketVector = std::vector<PacketRecordType>;
+    using EpochVector = EpochPackets<FlowKeyType>;
+    using ColumnsType = PacketColumns<FlowKeyType>;
+
+    static constexpr size_t DEFAULT_BATCH_SIZE = 65536;
+
+    // 流提取语义的版本：支持的封装、IPv6 折叠等会改变记录内容的修改都要加一，
+    // RecordCache 据此丢弃旧版本写出的缓存
+    static constexpr uint32_t EXTRACTOR_VERSION = 3;
+
+    // 流式读取：按文件顺序分批拉取记录，内存占用只与批大小有关
+    class Stream {
+       public:
+        Stream(const std::string& file_path, size_t batch_size);
+
+        // 用下一批记录替换 batch 的内容，读完时返回 false
+        bool next_batch(PacketVector& batch);
+
+        // 已读出的记录中地址由 IPv6 折叠而来的条数
+        uint64_t get_ipv6_records() const { return ipv6_records_; }
+
+       private:
+        std::unique_ptr<PcapReader> reader_;
+        size_t batch_size_;
+        uint64_t ipv6_records_;
+    };
+
+    // num_threads 大于 1 时对可映射的 pcap 文件分块并行解析，
+    // 0 表示使用全部硬件线程；并行解析的结果与单线程逐字节一致
+    explicit PacketParser(size_t num_threads = 1)
+        : num_threads_(num_threads), use_cache_(false), ipv6_records_(0) {}
+
+    // 启用解析结果缓存：parse_pcap 与 parse_pcap_columns 优先读取与源文件
+    // 匹配的缓存，未命中时正常解析并写入缓存。cache_dir 为空时缓存与 pcap
+    // 放在同一目录。open_stream 逐条读取源文件，不经过缓存
+    void enable_cache(const std::string& cache_dir = "") {
+        use_cache_ = true;
+        cache_dir_ = cache_dir;
+    }
 
     PacketVector parse_pcap(const std::string& file_path) const;
-    std::vector<PacketVector> parse_pcap_with_epochs(const std::string& file_path,
-                                                    std::chrono::nanoseconds epoch = std::chrono::nanoseconds{0}) const;
+    // 直接解析为列式存储，with_lengths 为 true 时同时填充报文长度列
+    ColumnsType parse_pcap_columns(const std::string& file_path,
+                                   bool with_lengths = false) const;
+    EpochVector parse_pcap_with_epochs(const std::string& file_path,
+                                       std::chrono::nanoseconds epoch = std::chrono::nanoseconds{0}) const;
+
+    // 最近一次 parse_pcap / parse_pcap_columns 的结果中地址由 IPv6 折叠而来的
+    // 记录数；非零时不同 IPv6 流可能在 ideal 中被合并，见 fold_ipv6_address。
+    // 同一对象被多个线程同时用于解析时该值没有意义
+    uint64_t get_ipv6_records() const { return ipv6_records_; }
+
+    // 把按时间排序的记录按 epoch 切分，只计算区间边界，不复制记录
+    // epoch 为 0 时整体作为一个 epoch，空 epoch 不出现在结果中
+    static EpochVector split_epochs(PacketVector packets,
+                                    std::chrono::nanoseconds epoch);
+
+    Stream open_stream(const std::string& file_path,
+                       size_t batch_size = DEFAULT_BATCH_SIZE) const {
+        return Stream(file_path, batch_size);
+    }
+
+    // 回调式流式接口，callback 以 const PacketVector& 接收每一批记录
+    template <typename Callback>
+    void for_each_batch(const std::string& file_path,
+                        Callback&& callback,
+                        size_t batch_size = DEFAULT_BATCH_SIZE) const {
+        Stream stream(file_path, batch_size);
+        PacketVector batch;
+        while (stream.next_batch(batch)) {
+            callback(static_cast<const PacketVector&>(batch));
+        }
+    }
+
+    // 解析单个数据包视图，供实时采集等非文件数据源使用
+    // 不含 IP 的包返回默认构造的 FlowKey
+    static FlowKeyType parse_packet(const PacketView& view) {
+        bool ipv6;
+        return extract_flow(view, view.link_type, ipv6);
+    }
 
    private:
-    // FlowKey提取函数
-    static FlowKeyType extract_flow(const pcpp::Packet& packet);
+    size_t num_threads_;
+    bool use_cache_;
+    std::string cache_dir_;
+    mutable uint64_t ipv6_records_;
+
+    // 插入排序允许的平均每条记录移动次数
+    static constexpr size_t INSERTION_SORT_BUDGET = 8;
+
+    // 解析整个文件到 PacketVector 或 PacketColumns
+    // ipv6_records 返回地址由 IPv6 折叠而来的记录数
+    template <typename Container>
+    void parse_into(const std::string& file_path,
+                    Container& out,
+                    uint64_t& ipv6_records) const;
+    template <typename Container>
+    void parse_parallel(const PcapReader& reader,
+                        size_t num_threads,
+                        size_t estimated_packets,
+                        Container& out,
+                        bool& is_sorted,
+                        uint64_t& ipv6_records) const;
+
+    static void append_record(PacketVector& packets,
+                              const FlowKeyType& flow,
+                              const PacketView& view);
+    static void append_record(ColumnsType& columns,
+                              const FlowKeyType& flow,
+                              const PacketView& view);
+    static void append_all(PacketVector& packets, PacketVector& chunk);
+    static void append_all(ColumnsType& columns, ColumnsType& chunk);
+
+    // 稳定排序，时间戳相同的记录保持文件中的先后顺序
+    static void sort_by_timestamp(PacketVector& packets, bool is_sorted);
+    static void sort_by_timestamp(ColumnsType& columns, bool is_sorted);
+
+    // 解析单个数据包：优先走报头快速路径，无法识别时回退到 pcpp 通用解析
+    // ipv6 返回最外层 IP 是否为 IPv6，即地址是否经过折叠
+    static FlowKeyType extract_flow(const PacketView& view,
+                                    pcpp::LinkLayerType link_type,
+                                    bool& ipv6);
+
+    // 直接按偏移遍历报头，不构造 pcpp::Packet。链路层支持 Ethernet、
+    // 802.1Q/QinQ、MPLS、Linux SLL/SLL2、原始 IP 与 loopback
+    // 返回 false 表示该链路层或以太类型需要交给 pcpp 解析
+    static bool extract_flow_fast(const PacketView& view,
+                                  pcpp::LinkLayerType link_type,
+                                  FlowKeyType& flow,
+                                  bool& ipv6);
+
+    // FlowKey提取函数，从 pcpp 解析出的最外层 IP 层取字段
+    static FlowKeyType extract_flow(const pcpp::Packet& packet, bool& ipv6);
 };
 
 #endif
@@ -0,0 +1,42 @@
+#ifndef RECORD_CACHE_H
+#define RECORD_CACHE_H
+
+#include <string>
+#include <vector>
+
+#include "PacketParser.h"
+
+// 解析结果的磁盘缓存
+// 文件由固定长度的头部和 PacketRecord 原始数组组成，记录区按 64 字节对齐，
+// 加载时整块读入 PacketVector，不逐条解码；
+// 头部记录源 pcap 的大小和修改时间以及流提取语义的版本，
+// 源文件变化或提取逻辑升级后缓存失效
+template <typename FlowKeyType, typename SFINAE = RequireFlowKey<FlowKeyType>>
+class RecordCache {
+   public:
+    using PacketRecordType = PacketRecord<FlowKeyType>;
+    using PacketVector = std::vector<PacketRecordType>;
+
+    // cache_dir 为空时缓存文件与 pcap 放在同一目录；否则放在 cache_dir 下，
+    // 文件名附带源文件绝对路径的哈希，不同目录下的同名 pcap 互不覆盖
+    explicit RecordCache(const std::string& cache_dir = "");
+
+    std::string cache_path(const std::string& pcap_path) const;
+
+    // 缓存不存在、格式不符或源文件已变化时返回 false
+    // ipv6_records 返回写入时记录的 IPv6 折叠记录数
+    bool load(const std::string& pcap_path,
+              PacketVector& packets,
+              uint64_t& ipv6_records) const;
+
+    // 先写临时文件再重命名，多个进程同时写入也不会读到半个文件
+    // 写入失败时返回 false，不影响调用方
+    bool store(const std::string& pcap_path,
+               const PacketVector& packets,
+               uint64_t ipv6_records) const;
+
+   private:
+    std::string cache_dir_;
+};
+
+#endif
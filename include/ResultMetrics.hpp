@@ -1,11 +1,21 @@
 #ifndef RESULT_METRICS_HPP
 #define RESULT_METRICS_HPP
 
+#include <algorithm>
+#include <cmath>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "FlatIdeal.h"
 #include "Ideal.h"
 #include "Sketch.h"
+#include "SketchExtensions.h"
+#include "SketchReplay.hpp"
 
 template <typename FlowKeyType, typename SFINAE = RequireFlowKey<FlowKeyType>>
 class ResultMetrics {
@@ -21,7 +31,7 @@ class ResultMetrics {
         uint32_t tn = 0;     // True Negatives
         uint32_t fp = 0;     // False Positives
         uint32_t fn = 0;     // False Negatives
-        uint32_t threshold;  // Heavy Hitter阈值
+        uint64_t threshold;  // Heavy Hitter阈值，单位与计数口径一致
 
         double get_precision() const {
             double total_positive = tp + fp;
@@ -54,46 +64,152 @@ class ResultMetrics {
         }
     };
 
+    // 全局统计量：真实值来自 ideal 表，估计值仅在 sketch 实现了
+    // 对应的估计接口时才有
+    struct GlobalMetric {
+        double cardinality = 0.0;
+        double entropy = 0.0;  // 流大小分布的经验熵，单位 bit
+
+        bool has_cardinality_estimate = false;
+        double estimated_cardinality = 0.0;
+        double cardinality_re = 0.0;
+
+        bool has_entropy_estimate = false;
+        double estimated_entropy = 0.0;
+        double entropy_re = 0.0;
+
+        // WMRE = sum|n_s - n'_s| / sum((n_s + n'_s) / 2)，n_s 为大小为 s 的流数
+        bool has_distribution_estimate = false;
+        double distribution_wmre = 0.0;
+    };
+
+    // ideal 与 sketch 须按同一口径（包数或字节数）构建，阈值使用同一单位
+    // num_threads 大于 1 时把 ideal 表分区并行评估，0 表示使用全部硬件线程，
+    // 结果与单线程在浮点舍入误差范围内一致
     ResultMetrics(const Ideal<FlowKeyType>& ideal,
                   const Sketch<FlowKeyType>& sketch,
-                  uint32_t hh_threshold) {
-        evaluate(ideal, sketch, hh_threshold);
+                  uint64_t hh_threshold,
+                  size_t num_threads = 1) {
+        evaluate(ideal, sketch, hh_threshold, num_threads);
     }
 
+    // 同上，ground truth 来自开放寻址的 FlatIdeal，按槽位顺序线性遍历
+    ResultMetrics(const FlatIdeal<FlowKeyType>& ideal,
+                  const Sketch<FlowKeyType>& sketch,
+                  uint64_t hh_threshold,
+                  size_t num_threads = 1) {
+        evaluate(ideal, sketch, hh_threshold, num_threads);
+    }
+
+    // 直接由记录评估：按 mode 口径构建 ground truth，按包时每个记录计 1，
+    // 按字节时计 PacketRecord::length；sketch 须已按同一口径插入，
+    // 阈值与 AAE 的单位随口径变化
+    ResultMetrics(const std::vector<PacketRecord<FlowKeyType>>& packets,
+                  const Sketch<FlowKeyType>& sketch,
+                  uint64_t hh_threshold,
+                  CountMode mode,
+                  size_t num_threads = 1)
+        : count_mode_(mode) {
+        FlatIdeal<FlowKeyType> ideal(packets.size());
+        SketchReplay<FlowKeyType>(mode).replay(packets, ideal);
+        evaluate(ideal, sketch, hh_threshold, num_threads);
+    }
+
+    // 由 ideal 构造时口径由调用方决定，这里记为 PACKETS
+    CountMode get_count_mode() const { return count_mode_; }
+
     const ErrorMetric& get_error_metric() const { return error_metric_; }
 
     const HeavyHitterMetric& get_heavy_hitter_metric() const {
         return heavy_hitter_metric_;
     }
 
-    // 拿到所有结果的 map
+    const GlobalMetric& get_global_metric() const { return global_metric_; }
+
+    // 固定顺序的指标名，与 get_metric_values 一一对应，可直接作为
+    // MetricsSink 的数值列
+    static const std::vector<std::string>& get_metric_names() {
+        static const std::vector<std::string> names = {
+            "are",
+            "aae",
+            "wmre",
+            "tp",
+            "tn",
+            "fp",
+            "fn",
+            "precision",
+            "recall",
+            "f1_score",
+            "accuracy",
+            "tpr",
+            "fpr",
+            "threshold",
+            "cardinality",
+            "entropy",
+            "cardinality_estimate",
+            "cardinality_re",
+            "entropy_estimate",
+            "entropy_re",
+            "distribution_wmre",
+        };
+        return names;
+    }
+
+    // 按 get_metric_names 的顺序填充 values，sketch 未提供的估计量为 NaN
+    // values 可在多次调用间复用，不会重复分配
+    void get_metric_values(std::vector<double>& values) const {
+        const double missing = std::numeric_limits<double>::quiet_NaN();
+        const GlobalMetric& global = global_metric_;
+
+        values.assign({
+            error_metric_.are,
+            error_metric_.aae,
+            error_metric_.wmre,
+            static_cast<double>(heavy_hitter_metric_.tp),
+            static_cast<double>(heavy_hitter_metric_.tn),
+            static_cast<double>(heavy_hitter_metric_.fp),
+            static_cast<double>(heavy_hitter_metric_.fn),
+            heavy_hitter_metric_.get_precision(),
+            heavy_hitter_metric_.get_recall(),
+            heavy_hitter_metric_.get_f1_score(),
+            heavy_hitter_metric_.get_accuracy(),
+            heavy_hitter_metric_.get_tpr(),
+            heavy_hitter_metric_.get_fpr(),
+            static_cast<double>(heavy_hitter_metric_.threshold),
+            global.cardinality,
+            global.entropy,
+            global.has_cardinality_estimate ? global.estimated_cardinality
+                                            : missing,
+            global.has_cardinality_estimate ? global.cardinality_re : missing,
+            global.has_entropy_estimate ? global.estimated_entropy : missing,
+            global.has_entropy_estimate ? global.entropy_re : missing,
+            global.has_distribution_estimate ? global.distribution_wmre
+                                             : missing,
+        });
+    }
+
+    // 拿到所有结果的 map，缺失的估计量不出现
     std::map<std::string, double> get_all_metrics() const {
         std::map<std::string, double> metrics;
 
-        metrics["are"] = error_metric_.are;
-        metrics["aae"] = error_metric_.aae;
-        metrics["wmre"] = error_metric_.wmre;
-
-        metrics["tp"] = static_cast<double>(heavy_hitter_metric_.tp);
-        metrics["tn"] = static_cast<double>(heavy_hitter_metric_.tn);
-        metrics["fp"] = static_cast<double>(heavy_hitter_metric_.fp);
-        metrics["fn"] = static_cast<double>(heavy_hitter_metric_.fn);
-        metrics["precision"] = heavy_hitter_metric_.get_precision();
-        metrics["recall"] = heavy_hitter_metric_.get_recall();
-        metrics["f1_score"] = heavy_hitter_metric_.get_f1_score();
-        metrics["accuracy"] = heavy_hitter_metric_.get_accuracy();
-        metrics["tpr"] = heavy_hitter_metric_.get_tpr();
-        metrics["fpr"] = heavy_hitter_metric_.get_fpr();
-        metrics["threshold"] =
-            static_cast<double>(heavy_hitter_metric_.threshold);
+        std::vector<double> values;
+        get_metric_values(values);
+        const auto& names = get_metric_names();
+        for (size_t i = 0; i < names.size(); ++i) {
+            if (!std::isnan(values[i])) {
+                metrics[names[i]] = values[i];
+            }
+        }
 
         return metrics;
     }
 
     void print_metrics() const {
+        const char* unit = count_mode_ == CountMode::BYTES ? " 字节" : "";
+
         std::cout << "\n=====================================" << std::endl;
         std::cout << "Heavy Hitter阈值: " << heavy_hitter_metric_.threshold
-                  << std::endl;
+                  << unit << std::endl;
 
         std::cout << std::fixed << std::setprecision(4);
         std::cout << "  " << std::left << std::setw(25)
@@ -136,21 +252,163 @@ class ResultMetrics {
                   << error_metric_.are * 100 << "%" << std::endl;
         std::cout << "  " << std::left << std::setw(25)
                   << "平均绝对误差 (AAE):" << std::right << std::setw(12)
-                  << error_metric_.aae << std::endl;
+                  << error_metric_.aae << unit << std::endl;
         std::cout << "  " << std::left << std::setw(25)
                   << "加权平均相对误差 (WMRE):" << std::right << std::setw(11)
                   << error_metric_.wmre * 100 << "%" << std::endl;
 
+        std::cout << "\n全局统计:" << std::endl;
+        std::cout << "  " << std::left << std::setw(25)
+                  << "流数 (Cardinality):" << std::right << std::setw(12)
+                  << global_metric_.cardinality << std::endl;
+        if (global_metric_.has_cardinality_estimate) {
+            std::cout << "  " << std::left << std::setw(25)
+                      << "流数估计相对误差:" << std::right << std::setw(11)
+                      << global_metric_.cardinality_re * 100 << "%"
+                      << std::endl;
+        }
+        std::cout << "  " << std::left << std::setw(25)
+                  << "熵 (Entropy):" << std::right << std::setw(12)
+                  << global_metric_.entropy << std::endl;
+        if (global_metric_.has_entropy_estimate) {
+            std::cout << "  " << std::left << std::setw(25)
+                      << "熵估计相对误差:" << std::right << std::setw(11)
+                      << global_metric_.entropy_re * 100 << "%" << std::endl;
+        }
+        if (global_metric_.has_distribution_estimate) {
+            std::cout << "  " << std::left << std::setw(25)
+                      << "流大小分布 WMRE:" << std::right << std::setw(12)
+                      << global_metric_.distribution_wmre << std::endl;
+        }
+
         std::cout << "=====================================\n" << std::endl;
     }
 
    private:
+    // 每个线程至少分到的流数，流太少时并行得不偿失
+    static constexpr size_t MIN_FLOWS_PER_THREAD = 4096;
+    // 每批查询的 key 数
+    static constexpr size_t QUERY_BATCH_SIZE = 256;
+
+    CountMode count_mode_ = CountMode::PACKETS;
     ErrorMetric error_metric_;
     HeavyHitterMetric heavy_hitter_metric_;
+    GlobalMetric global_metric_;
+
+    // 单个分区的中间结果，各线程分别累加后按分区顺序合并
+    struct PartialResult {
+        double sum_absolute_error = 0.0;
+        double sum_relative_error = 0.0;
+        double sum_weighted_relative_error = 0.0;
+        uint64_t total_count = 0;
+        uint32_t total_flows = 0;
+        uint32_t tp = 0;
+        uint32_t tn = 0;
+        uint32_t fp = 0;
+        uint32_t fn = 0;
+        // 熵计算用的 sum(c * log2(c))
+        double sum_count_log_count = 0.0;
+        // 流大小直方图，只在 sketch 能估计分布时统计
+        bool collect_sizes = false;
+        std::unordered_map<uint64_t, uint64_t> size_histogram;
+
+        void merge(const PartialResult& other) {
+            sum_absolute_error += other.sum_absolute_error;
+            sum_relative_error += other.sum_relative_error;
+            sum_weighted_relative_error += other.sum_weighted_relative_error;
+            total_count += other.total_count;
+            total_flows += other.total_flows;
+            tp += other.tp;
+            tn += other.tn;
+            fp += other.fp;
+            fn += other.fn;
+            sum_count_log_count += other.sum_count_log_count;
+            for (const auto& entry : other.size_histogram) {
+                size_histogram[entry.first] += entry.second;
+            }
+        }
+    };
+
+    // 累加 [first, last) 内各流的误差与混淆矩阵
+    // key 按批收集后统一查询，sketch 实现了 BatchQueryable 时可整批哈希、预取
+    template <typename Iterator>
+    static void accumulate(Iterator first,
+                           Iterator last,
+                           const Sketch<FlowKeyType>& sketch,
+                           uint64_t threshold,
+                           PartialResult& result) {
+        BatchQuery<FlowKeyType> query(sketch);
+        FlowKeyType keys[QUERY_BATCH_SIZE];
+        uint64_t true_counts[QUERY_BATCH_SIZE];
+        uint64_t estimates[QUERY_BATCH_SIZE];
+
+        while (first != last) {
+            size_t count = 0;
+            for (; first != last && count < QUERY_BATCH_SIZE; ++first) {
+                const auto& pair = *first;
+                keys[count] = pair.first;
+                true_counts[count] = pair.second;
+                ++count;
+            }
 
-    void evaluate(const Ideal<FlowKeyType>& ideal,
+            query(keys, count, estimates);
+
+            for (size_t i = 0; i < count; ++i) {
+                accumulate_one(true_counts[i], estimates[i], threshold, result);
+            }
+        }
+    }
+
+    static void accumulate_one(uint64_t true_count,
+                               uint64_t estimated_count,
+                               uint64_t threshold,
+                               PartialResult& result) {
+        // 更新误差统计
+        double absolute_error = std::abs(static_cast<double>(true_count) -
+                                         static_cast<double>(estimated_count));
+        result.sum_absolute_error += absolute_error;
+
+        if (true_count > 0) {
+            double relative_error =
+                absolute_error / static_cast<double>(true_count);
+            result.sum_relative_error += relative_error;
+            result.sum_weighted_relative_error +=
+                relative_error * static_cast<double>(true_count);
+        }
+
+        result.total_flows++;
+        result.total_count += true_count;
+
+        if (true_count > 0) {
+            double count = static_cast<double>(true_count);
+            result.sum_count_log_count += count * std::log2(count);
+        }
+        if (result.collect_sizes) {
+            result.size_histogram[true_count]++;
+        }
+
+        // 更新Heavy Hitter混淆矩阵
+        bool is_heavy_ideal = true_count >= threshold;
+        bool is_heavy_estimated = estimated_count >= threshold;
+
+        if (is_heavy_ideal && is_heavy_estimated) {
+            result.tp++;
+        } else if (!is_heavy_ideal && !is_heavy_estimated) {
+            result.tn++;
+        } else if (!is_heavy_ideal && is_heavy_estimated) {
+            result.fp++;
+        } else {
+            result.fn++;
+        }
+    }
+
+    // IdealTable 为 Ideal 或 FlatIdeal，二者的 get_raw_data 均可按
+    // (流, 计数) 对遍历
+    template <typename IdealTable>
+    void evaluate(const IdealTable& ideal,
                   const Sketch<FlowKeyType>& sketch,
-                  uint32_t threshold) {
+                  uint64_t threshold,
+                  size_t num_threads) {
         heavy_hitter_metric_.threshold = threshold;
 
         const auto& ideal_data = ideal.get_raw_data();
@@ -159,58 +417,209 @@ class ResultMetrics {
             return;
         }
 
-        uint64_t total_packets = 0;
-        double sum_absolute_error = 0.0;
-        double sum_relative_error = 0.0;
-        double sum_weighted_relative_error = 0.0;
-        uint32_t total_flows = 0;
+        const auto* distribution_estimator =
+            dynamic_cast<const DistributionEstimator*>(&sketch);
+
+        if (num_threads == 0) {
+            num_threads = std::max<size_t>(std::thread::hardware_concurrency(),
+                                           1);
+        }
+
+        PartialResult result;
+        result.collect_sizes = distribution_estimator != nullptr;
+        if (num_threads <= 1 || ideal_data.size() < MIN_FLOWS_PER_THREAD) {
+            // 遍历全部流
+            accumulate(ideal_data.begin(), ideal_data.end(), sketch, threshold,
+                       result);
+        } else {
+            result = evaluate_parallel(ideal_data, sketch, threshold,
+                                       num_threads, result.collect_sizes);
+        }
+
+        heavy_hitter_metric_.tp = result.tp;
+        heavy_hitter_metric_.tn = result.tn;
+        heavy_hitter_metric_.fp = result.fp;
+        heavy_hitter_metric_.fn = result.fn;
+
+        if (result.total_flows > 0) {
+            error_metric_.are = result.sum_relative_error / result.total_flows;
+            error_metric_.aae = result.sum_absolute_error / result.total_flows;
+        }
+
+        if (result.total_count > 0) {
+            error_metric_.wmre =
+                result.sum_weighted_relative_error / result.total_count;
+        }
+
+        evaluate_global(sketch, result, distribution_estimator);
+    }
+
+    void evaluate_global(const Sketch<FlowKeyType>& sketch,
+                         const PartialResult& result,
+                         const DistributionEstimator* distribution_estimator) {
+        global_metric_.cardinality = static_cast<double>(result.total_flows);
+        if (result.total_count > 0) {
+            double total = static_cast<double>(result.total_count);
+            global_metric_.entropy =
+                std::log2(total) - result.sum_count_log_count / total;
+        }
+
+        if (auto* estimator =
+                dynamic_cast<const CardinalityEstimator*>(&sketch)) {
+            global_metric_.has_cardinality_estimate = true;
+            global_metric_.estimated_cardinality =
+                estimator->estimate_cardinality();
+            global_metric_.cardinality_re =
+                relative_error(global_metric_.cardinality,
+                               global_metric_.estimated_cardinality);
+        }
+
+        if (auto* estimator = dynamic_cast<const EntropyEstimator*>(&sketch)) {
+            global_metric_.has_entropy_estimate = true;
+            global_metric_.estimated_entropy = estimator->estimate_entropy();
+            global_metric_.entropy_re =
+                relative_error(global_metric_.entropy,
+                               global_metric_.estimated_entropy);
+        }
+
+        if (distribution_estimator) {
+            std::vector<double> estimated;
+            distribution_estimator->estimate_distribution(estimated);
+            global_metric_.has_distribution_estimate = true;
+            global_metric_.distribution_wmre =
+                distribution_wmre(result.size_histogram, estimated);
+        }
+    }
+
+    static double relative_error(double true_value, double estimated_value) {
+        return true_value != 0.0
+                   ? std::abs(true_value - estimated_value) / true_value
+                   : 0.0;
+    }
+
+    static double distribution_wmre(
+        const std::unordered_map<uint64_t, uint64_t>& histogram,
+        const std::vector<double>& estimated) {
+        double numerator = 0.0;
+        double denominator = 0.0;
+
+        // 先处理真实直方图中出现的大小，再补上只在估计中出现的大小
+        for (const auto& entry : histogram) {
+            double n = static_cast<double>(entry.second);
+            double m = entry.first < estimated.size() ? estimated[entry.first]
+                                                      : 0.0;
+            numerator += std::abs(n - m);
+            denominator += (n + m) / 2.0;
+        }
+        for (size_t size = 0; size < estimated.size(); ++size) {
+            if (estimated[size] != 0.0 && histogram.count(size) == 0) {
+                numerator += std::abs(estimated[size]);
+                denominator += estimated[size] / 2.0;
+            }
+        }
+
+        return denominator > 0 ? numerator / denominator : 0.0;
+    }
+
+    // 按桶区间遍历 unordered_map，相当于只覆盖 [bucket, end_bucket) 的迭代器
+    template <typename Map>
+    class BucketIterator {
+       public:
+        BucketIterator(const Map& map, size_t bucket, size_t end_bucket)
+            : map_(&map), bucket_(bucket), end_bucket_(end_bucket) {
+            settle();
+        }
 
-        // 遍历全部流
-        for (const auto& pair : ideal_data) {
-            const auto& flow = pair.first;
-            uint64_t true_count = pair.second;
-            uint64_t estimated_count = sketch.query(flow);
-
-            // 更新误差统计
-            double absolute_error =
-                std::abs(static_cast<double>(true_count) -
-                         static_cast<double>(estimated_count));
-            sum_absolute_error += absolute_error;
-
-            if (true_count > 0) {
-                double relative_error =
-                    absolute_error / static_cast<double>(true_count);
-                sum_relative_error += relative_error;
-                sum_weighted_relative_error +=
-                    relative_error * static_cast<double>(true_count);
+        const typename Map::value_type& operator*() const { return *local_; }
+
+        BucketIterator& operator++() {
+            if (++local_ == map_->end(bucket_)) {
+                ++bucket_;
+                settle();
             }
+            return *this;
+        }
+
+        bool operator!=(const BucketIterator& other) const {
+            return bucket_ != other.bucket_ ||
+                   (bucket_ < end_bucket_ && local_ != other.local_);
+        }
 
-            total_flows++;
-            total_packets += true_count;
-
-            // 更新Heavy Hitter混淆矩阵
-            bool is_heavy_ideal = true_count >= threshold;
-            bool is_heavy_estimated = estimated_count >= threshold;
-
-            if (is_heavy_ideal && is_heavy_estimated) {
-                heavy_hitter_metric_.tp++;
-            } else if (!is_heavy_ideal && !is_heavy_estimated) {
-                heavy_hitter_metric_.tn++;
-            } else if (!is_heavy_ideal && is_heavy_estimated) {
-                heavy_hitter_metric_.fp++;
-            } else {
-                heavy_hitter_metric_.fn++;
+       private:
+        const Map* map_;
+        size_t bucket_;
+        size_t end_bucket_;
+        typename Map::const_local_iterator local_;
+
+        // 跳过空桶，停在下一个非空桶的第一个元素或 end_bucket_
+        void settle() {
+            while (bucket_ < end_bucket_ &&
+                   map_->begin(bucket_) == map_->end(bucket_)) {
+                ++bucket_;
+            }
+            if (bucket_ < end_bucket_) {
+                local_ = map_->begin(bucket_);
             }
         }
+    };
 
-        if (total_flows > 0) {
-            error_metric_.are = sum_relative_error / total_flows;
-            error_metric_.aae = sum_absolute_error / total_flows;
+    // 第 part 个分区（共 parts 个）的遍历区间，各线程直接从自己的区间开始，
+    // 不需要先串行遍历整张表
+    template <typename... MapArgs>
+    static std::pair<BucketIterator<std::unordered_map<MapArgs...>>,
+                     BucketIterator<std::unordered_map<MapArgs...>>>
+    partition(const std::unordered_map<MapArgs...>& data,
+              size_t part,
+              size_t parts) {
+        using Iterator = BucketIterator<std::unordered_map<MapArgs...>>;
+        size_t buckets = data.bucket_count();
+        size_t begin = buckets * part / parts;
+        size_t end = buckets * (part + 1) / parts;
+        return {Iterator(data, begin, end), Iterator(data, end, end)};
+    }
+
+    static std::pair<typename FlatIdeal<FlowKeyType>::RawData::const_iterator,
+                     typename FlatIdeal<FlowKeyType>::RawData::const_iterator>
+    partition(const typename FlatIdeal<FlowKeyType>::RawData& data,
+              size_t part,
+              size_t parts) {
+        size_t slots = data.slot_count();
+        return {data.at_slot(slots * part / parts),
+                data.at_slot(slots * (part + 1) / parts)};
+    }
+
+    // 按桶或槽位区间均分 ideal 表，sketch.query 需可并发调用
+    template <typename IdealData>
+    static PartialResult evaluate_parallel(const IdealData& ideal_data,
+                                           const Sketch<FlowKeyType>& sketch,
+                                           uint64_t threshold,
+                                           size_t num_threads,
+                                           bool collect_sizes) {
+        num_threads = std::min(num_threads,
+                               ideal_data.size() / MIN_FLOWS_PER_THREAD + 1);
+        std::vector<PartialResult> partials(num_threads);
+        for (auto& partial : partials) {
+            partial.collect_sizes = collect_sizes;
+        }
+        std::vector<std::thread> threads;
+        threads.reserve(num_threads);
+
+        for (size_t t = 0; t < num_threads; ++t) {
+            threads.emplace_back([&, t]() {
+                auto range = partition(ideal_data, t, num_threads);
+                accumulate(range.first, range.second, sketch, threshold,
+                           partials[t]);
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
         }
 
-        if (total_packets > 0) {
-            error_metric_.wmre = sum_weighted_relative_error / total_packets;
+        PartialResult result;
+        for (const auto& partial : partials) {
+            result.merge(partial);
         }
+        return result;
     }
 };
 
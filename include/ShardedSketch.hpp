@@ -0,0 +1,315 @@
+#ifndef SHARDED_SKETCH_HPP
+#define SHARDED_SKETCH_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "PacketParser.h"
+#include "Sketch.h"
+#include "SketchExtensions.h"
+
+// 按流哈希分片的多核 sketch
+// 每个分片是一个独立的 sketch 实例，只由一个工作线程更新，无需加锁。
+// 批量插入分两步：各线程先把自己那段记录按分片号分桶，再由每个线程
+// 依次回放属于自己分片的所有桶；工作线程在构造时启动、随对象销毁，
+// 多次 ingest 之间复用，不为每批记录重新创建线程
+template <typename FlowKeyType, typename SFINAE = RequireFlowKey<FlowKeyType>>
+class ShardedSketch : public Sketch<FlowKeyType> {
+   public:
+    using PacketRecordType = PacketRecord<FlowKeyType>;
+    using PacketVector = std::vector<PacketRecordType>;
+    using SketchFactory = std::function<std::unique_ptr<Sketch<FlowKeyType>>()>;
+
+    // OWNER：查询路由到 key 所在的分片，适用于任意 sketch；
+    // MERGED：把各分片合并为一个整体后查询，要求分片实现 Mergeable，
+    // 需在插入完成后调用 merge()
+    enum class QueryMode { OWNER, MERGED };
+
+    struct ScalingPoint {
+        size_t shards;
+        uint64_t packets;
+        double seconds;
+
+        double get_mpps() const {
+            return seconds > 0 ? static_cast<double>(packets) / seconds / 1e6
+                               : 0.0;
+        }
+    };
+
+    ShardedSketch(SketchFactory factory,
+                  size_t num_shards,
+                  QueryMode mode = QueryMode::OWNER,
+                  CountMode count_mode = CountMode::PACKETS)
+        : factory_(std::move(factory)),
+          mode_(mode),
+          count_mode_(count_mode) {
+        num_shards = std::max<size_t>(num_shards, 1);
+        shards_.reserve(num_shards);
+        for (size_t i = 0; i < num_shards; ++i) {
+            shards_.push_back(make_sketch());
+        }
+        buckets_.resize(num_shards);
+        workers_.reset(new WorkerPool(num_shards));
+    }
+
+    size_t get_shard_count() const { return shards_.size(); }
+    QueryMode get_query_mode() const { return mode_; }
+    const Sketch<FlowKeyType>& get_shard(size_t index) const {
+        return *shards_[index];
+    }
+
+    size_t shard_of(const FlowKeyType& flow) const {
+        // 对 std::hash 的结果再做一次混合，避免其低位分布不均
+        uint64_t h = static_cast<uint64_t>(std::hash<FlowKeyType>{}(flow));
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return static_cast<size_t>((h >> 32) * shards_.size() >> 32);
+    }
+
+    // 单线程更新，直接写入所属分片
+    void update(const FlowKeyType& flow, int increment = 1) override {
+        shards_[shard_of(flow)]->update(flow, increment);
+        merged_.reset();
+    }
+
+    uint64_t query(const FlowKeyType& flow) const override {
+        if (mode_ == QueryMode::OWNER) {
+            return shards_[shard_of(flow)]->query(flow);
+        }
+        if (!merged_) {
+            throw std::runtime_error("ShardedSketch: merge() before query");
+        }
+        return merged_->query(flow);
+    }
+
+    void clear() override {
+        for (auto& shard : shards_) {
+            shard->clear();
+        }
+        merged_.reset();
+    }
+
+    // 并行插入一批记录，每个分片一个线程；可对流式读取的各批次反复调用
+    void ingest(const PacketVector& packets) {
+        const size_t num_shards = shards_.size();
+        const size_t total = packets.size();
+        if (total == 0) {
+            return;
+        }
+        merged_.reset();
+
+        // 第一步：把记录切成与分片数相同的段，各线程按分片号分桶
+        for (size_t part = 0; part < num_shards; ++part) {
+            buckets_[part].resize(num_shards);
+        }
+        workers_->run([&](size_t part) {
+            size_t begin = total * part / num_shards;
+            size_t end = total * (part + 1) / num_shards;
+            std::vector<Bucket>& row = buckets_[part];
+            for (auto& bucket : row) {
+                bucket.clear();
+            }
+            for (size_t i = begin; i < end; ++i) {
+                const PacketRecordType& record = packets[i];
+                Bucket& bucket = row[shard_of(record.flow)];
+                bucket.keys.push_back(record.flow);
+                bucket.increments.push_back(record.weight(count_mode_));
+            }
+        });
+
+        // 第二步：每个线程只更新自己的分片
+        workers_->run([&](size_t shard) {
+            BatchUpdate<FlowKeyType> update(*shards_[shard]);
+            for (size_t part = 0; part < num_shards; ++part) {
+                const Bucket& bucket = buckets_[part][shard];
+                if (bucket.keys.empty()) {
+                    continue;
+                }
+                update(bucket.keys.data(), bucket.increments.data(),
+                       bucket.keys.size());
+            }
+        });
+    }
+
+    // 把全部分片合并成一个 sketch，MERGED 模式下查询前调用
+    void merge() {
+        std::unique_ptr<Sketch<FlowKeyType>> merged = make_sketch();
+        auto* target = dynamic_cast<Mergeable<FlowKeyType>*>(merged.get());
+        if (!target) {
+            throw std::runtime_error(
+                "ShardedSketch: sketch does not implement Mergeable");
+        }
+        for (const auto& shard : shards_) {
+            target->merge(*shard);
+        }
+        merged_ = std::move(merged);
+    }
+
+    // 依次用 1 到 max_shards 个分片插入同一批记录，测量吞吐
+    static std::vector<ScalingPoint> measure_scaling(
+        const SketchFactory& factory,
+        const PacketVector& packets,
+        size_t max_shards,
+        CountMode count_mode = CountMode::PACKETS) {
+        std::vector<ScalingPoint> points;
+        for (size_t shards = 1; shards <= max_shards; ++shards) {
+            ShardedSketch sketch(factory, shards, QueryMode::OWNER, count_mode);
+            // 先跑一遍预热分桶缓冲区，计时的一遍不包含扩容；
+            // 工作线程在构造时已经启动，也不计入耗时
+            sketch.ingest(packets);
+            sketch.clear();
+
+            auto start = std::chrono::steady_clock::now();
+            sketch.ingest(packets);
+            double seconds = std::chrono::duration<double>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+            points.push_back(ScalingPoint{shards, packets.size(), seconds});
+        }
+        return points;
+    }
+
+   private:
+    struct Bucket {
+        std::vector<FlowKeyType> keys;
+        std::vector<int> increments;
+
+        void clear() {
+            keys.clear();
+            increments.clear();
+        }
+    };
+
+    SketchFactory factory_;
+    QueryMode mode_;
+    CountMode count_mode_;
+    std::vector<std::unique_ptr<Sketch<FlowKeyType>>> shards_;
+    std::unique_ptr<Sketch<FlowKeyType>> merged_;
+    // buckets_[段][分片]，在多次 ingest 之间复用
+    std::vector<std::vector<Bucket>> buckets_;
+
+    std::unique_ptr<Sketch<FlowKeyType>> make_sketch() const {
+        std::unique_ptr<Sketch<FlowKeyType>> sketch = factory_();
+        if (!sketch) {
+            throw std::runtime_error("ShardedSketch: factory returned null");
+        }
+        return sketch;
+    }
+
+    // 常驻的工作线程：构造时启动 count - 1 个线程，销毁时回收；
+    // run 让各线程执行 task(1..count-1)，当前线程承担第 0 个，全部完成后返回
+    class WorkerPool {
+       public:
+        using Task = std::function<void(size_t)>;
+
+        explicit WorkerPool(size_t count)
+            : errors_(count),
+              task_(nullptr),
+              generation_(0),
+              pending_(0),
+              stopping_(false) {
+            threads_.reserve(count - 1);
+            for (size_t i = 1; i < count; ++i) {
+                threads_.emplace_back(&WorkerPool::work, this, i);
+            }
+        }
+
+        ~WorkerPool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            start_.notify_all();
+            for (auto& thread : threads_) {
+                thread.join();
+            }
+        }
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        // 任一任务抛出异常时，等全部任务结束后重新抛出第一个
+        void run(const Task& task) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                task_ = &task;
+                pending_ = threads_.size();
+                ++generation_;
+            }
+            start_.notify_all();
+            execute(0);
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                done_.wait(lock, [this]() { return pending_ == 0; });
+                task_ = nullptr;
+            }
+
+            std::exception_ptr error;
+            for (auto& slot : errors_) {
+                if (slot && !error) {
+                    error = slot;
+                }
+                slot = nullptr;
+            }
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+
+       private:
+        std::vector<std::thread> threads_;
+        std::vector<std::exception_ptr> errors_;
+        std::mutex mutex_;
+        std::condition_variable start_;
+        std::condition_variable done_;
+        const Task* task_;
+        uint64_t generation_;
+        size_t pending_;
+        bool stopping_;
+
+        void work(size_t index) {
+            uint64_t seen = 0;
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    start_.wait(lock, [&]() {
+                        return stopping_ || generation_ != seen;
+                    });
+                    if (stopping_) {
+                        return;
+                    }
+                    seen = generation_;
+                }
+                execute(index);
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (--pending_ == 0) {
+                        done_.notify_one();
+                    }
+                }
+            }
+        }
+
+        void execute(size_t index) {
+            try {
+                (*task_)(index);
+            } catch (...) {
+                errors_[index] = std::current_exception();
+            }
+        }
+    };
+
+    std::unique_ptr<WorkerPool> workers_;
+};
+
+#endif  // SHARDED_SKETCH_HPP
@@ -0,0 +1,154 @@
+#ifndef SKETCH_EXTENSIONS_H
+#define SKETCH_EXTENSIONS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Sketch.h"
+
+// Sketch 可选扩展接口
+// SketchLib 中的 Sketch 只提供逐个 key 的虚函数；具体实现可以额外继承
+// 下列接口，Medivh 的评估与回放代码在运行时检测并优先使用
+
+// 预取一个计数器所在的缓存行，供批量接口的实现使用
+inline void prefetch_counter(const void* addr) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(addr, 0, 3);
+#else
+    (void)addr;
+#endif
+}
+
+// 批量查询：实现可以先为整批 key 计算各行哈希并预取计数器，再统一读取
+template <typename FlowKeyType, typename SFINAE = RequireFlowKey<FlowKeyType>>
+class BatchQueryable {
+   public:
+    virtual ~BatchQueryable() = default;
+
+    // 估计 keys[0, count) 的频率，结果依次写入 estimates
+    virtual void query_batch(const FlowKeyType* keys,
+                             size_t count,
+                             uint64_t* estimates) const = 0;
+};
+
+// 批量查询任意 sketch，未实现 BatchQueryable 时逐个调用 query
+template <typename FlowKeyType>
+class BatchQuery {
+   public:
+    explicit BatchQuery(const Sketch<FlowKeyType>& sketch)
+        : sketch_(sketch),
+          batch_(dynamic_cast<const BatchQueryable<FlowKeyType>*>(&sketch)) {}
+
+    void operator()(const FlowKeyType* keys,
+                    size_t count,
+                    uint64_t* estimates) const {
+        if (batch_) {
+            batch_->query_batch(keys, count, estimates);
+            return;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            estimates[i] = sketch_.query(keys[i]);
+        }
+    }
+
+   private:
+    const Sketch<FlowKeyType>& sketch_;
+    const BatchQueryable<FlowKeyType>* batch_;
+};
+
+// 批量插入：实现可以按"先哈希整批、再预取、最后更新"的流水线处理
+template <typename FlowKeyType, typename SFINAE = RequireFlowKey<FlowKeyType>>
+class BatchInsertable {
+   public:
+    virtual ~BatchInsertable() = default;
+
+    // 依次将 keys[i] 的计数增加 increments[i]
+    // increments 为空指针时每个 key 增加 1
+    virtual void update_batch(const FlowKeyType* keys,
+                              const int* increments,
+                              size_t count) = 0;
+};
+
+// 批量更新任意 sketch，未实现 BatchInsertable 时逐个调用 update
+template <typename FlowKeyType>
+class BatchUpdate {
+   public:
+    explicit BatchUpdate(Sketch<FlowKeyType>& sketch)
+        : sketch_(sketch),
+          batch_(dynamic_cast<BatchInsertable<FlowKeyType>*>(&sketch)) {}
+
+    bool is_batched() const { return batch_ != nullptr; }
+
+    void operator()(const FlowKeyType* keys,
+                    const int* increments,
+                    size_t count) const {
+        if (batch_) {
+            batch_->update_batch(keys, increments, count);
+            return;
+        }
+        if (increments) {
+            for (size_t i = 0; i < count; ++i) {
+                sketch_.update(keys[i], increments[i]);
+            }
+        } else {
+            for (size_t i = 0; i < count; ++i) {
+                sketch_.update(keys[i]);
+            }
+        }
+    }
+
+   private:
+    Sketch<FlowKeyType>& sketch_;
+    BatchInsertable<FlowKeyType>* batch_;
+};
+
+// 候选大流：维护了 heavy hitter 候选表的 sketch（如 HeavyKeeper、
+// SpaceSaving 类结构）可直接给出候选及其估计值，top-k 评估不必扫描全部流
+template <typename FlowKeyType, typename SFINAE = RequireFlowKey<FlowKeyType>>
+class HeavyHitterCandidates {
+   public:
+    virtual ~HeavyHitterCandidates() = default;
+
+    // 用当前全部候选及其估计值替换 candidates 的内容，顺序不限
+    virtual void get_candidates(
+        std::vector<std::pair<FlowKeyType, uint64_t>>& candidates) const = 0;
+};
+
+// 线性可合并：把参数相同（宽度、深度、哈希种子一致）的另一个实例的计数
+// 累加到自身，合并结果等同于在同一实例上插入两边的全部数据
+template <typename FlowKeyType, typename SFINAE = RequireFlowKey<FlowKeyType>>
+class Mergeable {
+   public:
+    virtual ~Mergeable() = default;
+
+    // other 与自身类型或参数不一致时抛出异常
+    virtual void merge(const Sketch<FlowKeyType>& other) = 0;
+};
+
+// 全局统计量估计，ResultMetrics 用 ideal 表中的真实值与之比较
+
+// 不同流的数量
+class CardinalityEstimator {
+   public:
+    virtual ~CardinalityEstimator() = default;
+    virtual double estimate_cardinality() const = 0;
+};
+
+// 流大小分布的经验熵，以 2 为底
+class EntropyEstimator {
+   public:
+    virtual ~EntropyEstimator() = default;
+    virtual double estimate_entropy() const = 0;
+};
+
+// 流大小分布：distribution[s] 为大小恰为 s 的流的估计数量
+class DistributionEstimator {
+   public:
+    virtual ~DistributionEstimator() = default;
+    virtual void estimate_distribution(
+        std::vector<double>& distribution) const = 0;
+};
+
+#endif  // SKETCH_EXTENSIONS_H
@@ -0,0 +1,149 @@
+#ifndef SKETCH_REPLAY_HPP
+#define SKETCH_REPLAY_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "PacketParser.h"
+#include "Sketch.h"
+#include "SketchExtensions.h"
+
+// 回放吞吐统计
+struct ReplayStats {
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    double seconds = 0.0;
+    bool batched = false;  // sketch 是否走了 BatchInsertable 接口
+
+    // 每秒百万包数
+    double get_mpps() const {
+        return seconds > 0 ? static_cast<double>(packets) / seconds / 1e6
+                           : 0.0;
+    }
+
+    void print(std::ostream& os = std::cout) const {
+        os << std::fixed << std::setprecision(3) << "回放 " << packets
+           << " 包, 耗时 " << seconds << " 秒, 吞吐 " << get_mpps()
+           << " Mpps" << (batched ? " (批量接口)" : " (逐个更新)")
+           << std::endl;
+    }
+};
+
+// 将解析得到的记录按固定大小的批次写入 sketch
+// 每批先收集 key 与增量，再一次性交给 BatchUpdate，计时只覆盖回放本身
+template <typename FlowKeyType, typename SFINAE = RequireFlowKey<FlowKeyType>>
+class SketchReplay {
+   public:
+    using PacketRecordType = PacketRecord<FlowKeyType>;
+    using PacketVector = std::vector<PacketRecordType>;
+    using ColumnsType = PacketColumns<FlowKeyType>;
+    using EpochView = RecordSpan<PacketRecordType>;
+
+    static constexpr size_t DEFAULT_BATCH_SIZE = 256;
+
+    explicit SketchReplay(CountMode mode = CountMode::PACKETS,
+                          size_t batch_size = DEFAULT_BATCH_SIZE)
+        : count_mode_(mode),
+          batch_size_(std::max<size_t>(batch_size, 1)),
+          keys_(batch_size_),
+          increments_(batch_size_) {}
+
+    CountMode get_count_mode() const { return count_mode_; }
+    size_t get_batch_size() const { return batch_size_; }
+
+    ReplayStats replay(const PacketVector& packets,
+                       Sketch<FlowKeyType>& sketch) {
+        return replay_records(packets.data(), packets.data() + packets.size(),
+                              sketch);
+    }
+
+    ReplayStats replay(const EpochView& packets, Sketch<FlowKeyType>& sketch) {
+        return replay_records(packets.begin(), packets.end(), sketch);
+    }
+
+    // 按包计数时 keys() 本身就是连续数组，直接分段交给 sketch，不再拷贝
+    ReplayStats replay(const ColumnsType& columns,
+                       Sketch<FlowKeyType>& sketch) {
+        if (count_mode_ == CountMode::BYTES && !columns.has_lengths()) {
+            throw std::runtime_error("按字节回放需要带包长的列存储");
+        }
+
+        BatchUpdate<FlowKeyType> update(sketch);
+        const auto& keys = columns.keys();
+        const size_t total = keys.size();
+
+        ReplayStats stats;
+        stats.batched = update.is_batched();
+        auto start = std::chrono::steady_clock::now();
+
+        for (size_t base = 0; base < total; base += batch_size_) {
+            size_t count = std::min(batch_size_, total - base);
+            const int* increments = nullptr;
+            if (count_mode_ == CountMode::BYTES) {
+                const uint32_t* lengths = columns.lengths().data() + base;
+                for (size_t i = 0; i < count; ++i) {
+                    increments_[i] = count_weight(count_mode_, lengths[i]);
+                }
+                increments = increments_.data();
+            }
+            update(keys.data() + base, increments, count);
+        }
+
+        stats.seconds = elapsed_since(start);
+        stats.packets = total;
+        if (columns.has_lengths()) {
+            for (uint32_t length : columns.lengths()) {
+                stats.bytes += length;
+            }
+        }
+        return stats;
+    }
+
+   private:
+    CountMode count_mode_;
+    size_t batch_size_;
+    // 批次缓冲在对象内复用，多次回放不重复分配
+    std::vector<FlowKeyType> keys_;
+    std::vector<int> increments_;
+
+    ReplayStats replay_records(const PacketRecordType* first,
+                               const PacketRecordType* last,
+                               Sketch<FlowKeyType>& sketch) {
+        BatchUpdate<FlowKeyType> update(sketch);
+
+        ReplayStats stats;
+        stats.batched = update.is_batched();
+        auto start = std::chrono::steady_clock::now();
+
+        for (const PacketRecordType* record = first; record != last;) {
+            size_t count = 0;
+            for (; record != last && count < batch_size_; ++record) {
+                keys_[count] = record->flow;
+                increments_[count] = record->weight(count_mode_);
+                ++count;
+            }
+            update(keys_.data(), increments_.data(), count);
+        }
+
+        stats.seconds = elapsed_since(start);
+        // 包数与字节数在计时结束后统计，不计入回放耗时
+        stats.packets = static_cast<uint64_t>(last - first);
+        for (; first != last; ++first) {
+            stats.bytes += first->length;
+        }
+        return stats;
+    }
+
+    static double elapsed_since(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                             start)
+            .count();
+    }
+};
+
+#endif  // SKETCH_REPLAY_HPP
@@ -0,0 +1,175 @@
+#ifndef SKETCH_SWEEP_HPP
+#define SKETCH_SWEEP_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "FlatIdeal.h"
+#include "MetricsSink.h"
+#include "PacketParser.h"
+#include "ResultMetrics.hpp"
+#include "Sketch.h"
+#include "SketchReplay.hpp"
+
+// 参数扫描：同一条 trace 只解析一次、ideal 只构建一次，
+// 多个 sketch 配置由工作线程并发回放同一份只读记录并各自评估
+template <typename FlowKeyType, typename SFINAE = RequireFlowKey<FlowKeyType>>
+class SketchSweep {
+   public:
+    using PacketRecordType = PacketRecord<FlowKeyType>;
+    using PacketVector = std::vector<PacketRecordType>;
+    using SketchFactory = std::function<std::unique_ptr<Sketch<FlowKeyType>>()>;
+    using MetricsType = ResultMetrics<FlowKeyType>;
+
+    struct SweepResult {
+        std::string name;
+        ReplayStats replay;
+        MetricsType metrics;
+    };
+
+    // num_threads 为 0 时使用全部硬件线程，同时用于解析和扫描
+    SketchSweep(const std::string& file_path,
+                uint64_t hh_threshold,
+                CountMode mode = CountMode::PACKETS,
+                size_t num_threads = 0)
+        : SketchSweep(PacketParser<FlowKeyType>(resolve_threads(num_threads))
+                          .parse_pcap(file_path),
+                      hh_threshold,
+                      mode,
+                      num_threads) {}
+
+    SketchSweep(PacketVector packets,
+                uint64_t hh_threshold,
+                CountMode mode = CountMode::PACKETS,
+                size_t num_threads = 0)
+        : packets_(std::move(packets)),
+          hh_threshold_(hh_threshold),
+          count_mode_(mode),
+          num_threads_(resolve_threads(num_threads)) {
+        SketchReplay<FlowKeyType>(count_mode_).replay(packets_, ideal_);
+    }
+
+    // factory 在工作线程中调用，每个配置构造一个独立的 sketch
+    void add_config(const std::string& name, SketchFactory factory) {
+        configs_.push_back(Config{name, std::move(factory)});
+    }
+
+    size_t get_config_count() const { return configs_.size(); }
+    const PacketVector& get_packets() const { return packets_; }
+    const FlatIdeal<FlowKeyType>& get_ideal() const { return ideal_; }
+
+    // 写入 MetricsSink 时使用的列
+    static std::vector<std::string> get_label_columns() { return {"config"}; }
+    static std::vector<std::string> get_value_columns() {
+        std::vector<std::string> columns = MetricsType::get_metric_names();
+        columns.push_back("packets");
+        columns.push_back("replay_seconds");
+        columns.push_back("mpps");
+        return columns;
+    }
+
+    // 运行全部配置，结果与 add_config 的顺序一致
+    // sink 非空时每完成一个配置写入一行；任一配置抛出的异常在全部线程
+    // 结束后重新抛出
+    std::vector<SweepResult> run(MetricsSink* sink = nullptr) const {
+        std::vector<std::unique_ptr<SweepResult>> slots(configs_.size());
+        std::atomic<size_t> next{0};
+        std::exception_ptr error;
+        std::mutex error_mutex;
+
+        auto worker = [&]() {
+            std::vector<double> values;
+            size_t index;
+            while ((index = next.fetch_add(1)) < configs_.size()) {
+                try {
+                    slots[index] = run_config(configs_[index]);
+                    if (sink) {
+                        write_row(*slots[index], values, *sink);
+                    }
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                }
+            }
+        };
+
+        size_t num_threads = std::min(num_threads_, configs_.size());
+        std::vector<std::thread> threads;
+        threads.reserve(num_threads);
+        for (size_t t = 0; t < num_threads; ++t) {
+            threads.emplace_back(worker);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+
+        std::vector<SweepResult> results;
+        results.reserve(slots.size());
+        for (auto& slot : slots) {
+            results.push_back(std::move(*slot));
+        }
+        return results;
+    }
+
+   private:
+    struct Config {
+        std::string name;
+        SketchFactory factory;
+    };
+
+    PacketVector packets_;
+    // 从最小容量开始按需扩容，容量只与流数有关，不随记录数增长
+    FlatIdeal<FlowKeyType> ideal_;
+    uint64_t hh_threshold_;
+    CountMode count_mode_;
+    size_t num_threads_;
+    std::vector<Config> configs_;
+
+    static size_t resolve_threads(size_t num_threads) {
+        if (num_threads == 0) {
+            num_threads = std::thread::hardware_concurrency();
+        }
+        return std::max<size_t>(num_threads, 1);
+    }
+
+    std::unique_ptr<SweepResult> run_config(const Config& config) const {
+        std::unique_ptr<Sketch<FlowKeyType>> sketch = config.factory();
+        if (!sketch) {
+            throw std::runtime_error("sketch 配置未能构造: " + config.name);
+        }
+
+        ReplayStats replay =
+            SketchReplay<FlowKeyType>(count_mode_).replay(packets_, *sketch);
+        MetricsType metrics(ideal_, *sketch, hh_threshold_);
+
+        return std::unique_ptr<SweepResult>(
+            new SweepResult{config.name, replay, std::move(metrics)});
+    }
+
+    static void write_row(const SweepResult& result,
+                          std::vector<double>& values,
+                          MetricsSink& sink) {
+        result.metrics.get_metric_values(values);
+        values.push_back(static_cast<double>(result.replay.packets));
+        values.push_back(result.replay.seconds);
+        values.push_back(result.replay.get_mpps());
+        sink.write({result.name}, values);
+    }
+};
+
+#endif  // SKETCH_SWEEP_HPP
@@ -0,0 +1,76 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// 单生产者单消费者无锁环形队列
+// 生产者只写 tail_，消费者只写 head_，两者分处不同缓存行；
+// 容量向上取整为 2 的幂
+template <typename T>
+class SpscRing {
+   public:
+    explicit SpscRing(size_t capacity)
+        : mask_(round_up(capacity) - 1),
+          slots_(mask_ + 1),
+          head_(0),
+          tail_(0) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // 仅由生产者调用，队列满时返回 false 且不移动 item
+    bool try_push(T& item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) > mask_) {
+            return false;
+        }
+        slots_[tail & mask_] = std::move(item);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 仅由消费者调用，队列空时返回 false
+    bool try_pop(T& item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) ==
+               tail_.load(std::memory_order_acquire);
+    }
+
+    bool full() const {
+        return tail_.load(std::memory_order_acquire) -
+                   head_.load(std::memory_order_acquire) >
+               mask_;
+    }
+
+   private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    static size_t round_up(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    const size_t mask_;
+    std::vector<T> slots_;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> head_;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail_;
+};
+
+#endif
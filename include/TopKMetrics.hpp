@@ -0,0 +1,311 @@
+#ifndef TOP_K_METRICS_HPP
+#define TOP_K_METRICS_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "FlatIdeal.h"
+#include "Ideal.h"
+#include "Sketch.h"
+#include "SketchExtensions.h"
+
+// Top-k 排序类指标：precision@k、recall@k 与 Spearman 秩相关系数
+// 真实 top-k 用大小为 k 的堆从 ideal 表中选出；sketch 实现了
+// HeavyHitterCandidates 时直接从候选表取估计 top-k，查询量只与 k 相关，
+// 否则回退为对 ideal 中每条流查询一次
+template <typename FlowKeyType, typename SFINAE = RequireFlowKey<FlowKeyType>>
+class TopKMetrics {
+   public:
+    using FlowCount = std::pair<FlowKeyType, uint64_t>;
+
+    struct RankMetric {
+        size_t k = 0;
+        size_t hits = 0;         // 两个 top-k 集合的交集大小
+        double precision = 0.0;  // hits / 估计 top-k 的大小
+        double recall = 0.0;     // hits / 真实 top-k 的大小
+        double spearman = 0.0;   // 真实 top-k 上真实值与估计值的秩相关
+        double are = 0.0;        // 真实 top-k 上的平均相对误差
+        bool used_candidates = false;
+    };
+
+    TopKMetrics(const Ideal<FlowKeyType>& ideal,
+                const Sketch<FlowKeyType>& sketch,
+                size_t k) {
+        evaluate(ideal, sketch, k);
+    }
+
+    TopKMetrics(const FlatIdeal<FlowKeyType>& ideal,
+                const Sketch<FlowKeyType>& sketch,
+                size_t k) {
+        evaluate(ideal, sketch, k);
+    }
+
+    const RankMetric& get_rank_metric() const { return rank_metric_; }
+
+    // 按计数从大到小排列
+    const std::vector<FlowCount>& get_true_top_k() const { return true_top_; }
+    const std::vector<FlowCount>& get_estimated_top_k() const {
+        return estimated_top_;
+    }
+
+    std::map<std::string, double> get_all_metrics() const {
+        std::map<std::string, double> metrics;
+
+        metrics["k"] = static_cast<double>(rank_metric_.k);
+        metrics["hits_at_k"] = static_cast<double>(rank_metric_.hits);
+        metrics["precision_at_k"] = rank_metric_.precision;
+        metrics["recall_at_k"] = rank_metric_.recall;
+        metrics["spearman_at_k"] = rank_metric_.spearman;
+        metrics["are_at_k"] = rank_metric_.are;
+
+        return metrics;
+    }
+
+    void print_metrics() const {
+        std::cout << "\n=====================================" << std::endl;
+        std::cout << "Top-k 评估, k = " << rank_metric_.k
+                  << (rank_metric_.used_candidates ? " (候选表)" : " (全表查询)")
+                  << std::endl;
+
+        std::cout << std::fixed << std::setprecision(4);
+        std::cout << "  " << std::left << std::setw(25)
+                  << "命中数 (Hits@k):" << std::right << std::setw(12)
+                  << rank_metric_.hits << std::endl;
+        std::cout << "  " << std::left << std::setw(25)
+                  << "精度 (Precision@k):" << std::right << std::setw(11)
+                  << rank_metric_.precision * 100 << "%" << std::endl;
+        std::cout << "  " << std::left << std::setw(25)
+                  << "召回率 (Recall@k):" << std::right << std::setw(11)
+                  << rank_metric_.recall * 100 << "%" << std::endl;
+        std::cout << "  " << std::left << std::setw(25)
+                  << "秩相关 (Spearman):" << std::right << std::setw(12)
+                  << rank_metric_.spearman << std::endl;
+        std::cout << "  " << std::left << std::setw(25)
+                  << "平均相对误差 (ARE@k):" << std::right << std::setw(11)
+                  << rank_metric_.are * 100 << "%" << std::endl;
+
+        std::cout << "=====================================\n" << std::endl;
+    }
+
+   private:
+    // 每批查询的 key 数
+    static constexpr size_t QUERY_BATCH_SIZE = 256;
+
+    RankMetric rank_metric_;
+    std::vector<FlowCount> true_top_;
+    std::vector<FlowCount> estimated_top_;
+
+    // 容量为 k 的小根堆，堆顶是当前入选的最小计数
+    class BoundedHeap {
+       public:
+        explicit BoundedHeap(size_t k) : k_(k) { heap_.reserve(k); }
+
+        void push(const FlowKeyType& flow, uint64_t count) {
+            if (k_ == 0) {
+                return;
+            }
+            if (heap_.size() < k_) {
+                heap_.emplace_back(flow, count);
+                std::push_heap(heap_.begin(), heap_.end(), greater_count);
+            } else if (count > heap_.front().second) {
+                std::pop_heap(heap_.begin(), heap_.end(), greater_count);
+                heap_.back() = FlowCount(flow, count);
+                std::push_heap(heap_.begin(), heap_.end(), greater_count);
+            }
+        }
+
+        // 取出全部元素，按计数从大到小排列
+        void take_sorted(std::vector<FlowCount>& out) {
+            std::sort_heap(heap_.begin(), heap_.end(), greater_count);
+            out.swap(heap_);
+            heap_.clear();
+        }
+
+       private:
+        size_t k_;
+        std::vector<FlowCount> heap_;
+
+        static bool greater_count(const FlowCount& a, const FlowCount& b) {
+            return a.second > b.second;
+        }
+    };
+
+    template <typename IdealTable>
+    void evaluate(const IdealTable& ideal,
+                  const Sketch<FlowKeyType>& sketch,
+                  size_t k) {
+        rank_metric_.k = k;
+
+        const auto& ideal_data = ideal.get_raw_data();
+
+        BoundedHeap true_heap(k);
+        for (const auto& pair : ideal_data) {
+            true_heap.push(pair.first, pair.second);
+        }
+        true_heap.take_sorted(true_top_);
+
+        select_estimated(ideal_data, sketch, k);
+
+        if (true_top_.empty()) {
+            return;
+        }
+
+        std::unordered_set<FlowKeyType> true_set;
+        true_set.reserve(true_top_.size());
+        for (const auto& entry : true_top_) {
+            true_set.insert(entry.first);
+        }
+        for (const auto& entry : estimated_top_) {
+            rank_metric_.hits += true_set.count(entry.first);
+        }
+
+        rank_metric_.recall =
+            static_cast<double>(rank_metric_.hits) / true_top_.size();
+        if (!estimated_top_.empty()) {
+            rank_metric_.precision =
+                static_cast<double>(rank_metric_.hits) / estimated_top_.size();
+        }
+
+        // 在真实 top-k 上比较真实值与 sketch 估计值
+        std::vector<FlowKeyType> keys;
+        std::vector<double> true_counts;
+        keys.reserve(true_top_.size());
+        true_counts.reserve(true_top_.size());
+        for (const auto& entry : true_top_) {
+            keys.push_back(entry.first);
+            true_counts.push_back(static_cast<double>(entry.second));
+        }
+
+        std::vector<uint64_t> estimates(keys.size());
+        BatchQuery<FlowKeyType> query(sketch);
+        query(keys.data(), keys.size(), estimates.data());
+
+        std::vector<double> estimated_counts(estimates.begin(),
+                                             estimates.end());
+        double sum_relative_error = 0.0;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (true_counts[i] > 0) {
+                sum_relative_error +=
+                    std::abs(true_counts[i] - estimated_counts[i]) /
+                    true_counts[i];
+            }
+        }
+        rank_metric_.are = sum_relative_error / keys.size();
+        rank_metric_.spearman = spearman(true_counts, estimated_counts);
+    }
+
+    template <typename IdealData>
+    void select_estimated(const IdealData& ideal_data,
+                          const Sketch<FlowKeyType>& sketch,
+                          size_t k) {
+        BoundedHeap estimated_heap(k);
+
+        auto* candidates =
+            dynamic_cast<const HeavyHitterCandidates<FlowKeyType>*>(&sketch);
+        if (candidates) {
+            std::vector<FlowCount> list;
+            candidates->get_candidates(list);
+            // 候选列表可能重复给出同一条流（如多个分片或多行各存一份），
+            // 按流去重并保留最大的估计值，否则同一条流会占据多个名额；
+            // 去重后保持首次出现的顺序，计数相同时的取舍与原列表一致
+            std::unordered_map<FlowKeyType, size_t> position;
+            position.reserve(list.size());
+            size_t unique = 0;
+            for (size_t i = 0; i < list.size(); ++i) {
+                auto inserted = position.emplace(list[i].first, unique);
+                if (inserted.second) {
+                    list[unique++] = list[i];
+                } else {
+                    FlowCount& kept = list[inserted.first->second];
+                    kept.second = std::max(kept.second, list[i].second);
+                }
+            }
+            list.resize(unique);
+            for (const auto& entry : list) {
+                estimated_heap.push(entry.first, entry.second);
+            }
+            rank_metric_.used_candidates = true;
+        } else {
+            BatchQuery<FlowKeyType> query(sketch);
+            FlowKeyType keys[QUERY_BATCH_SIZE];
+            uint64_t estimates[QUERY_BATCH_SIZE];
+
+            auto first = ideal_data.begin();
+            while (first != ideal_data.end()) {
+                size_t count = 0;
+                for (; first != ideal_data.end() && count < QUERY_BATCH_SIZE;
+                     ++first) {
+                    keys[count++] = first->first;
+                }
+                query(keys, count, estimates);
+                for (size_t i = 0; i < count; ++i) {
+                    estimated_heap.push(keys[i], estimates[i]);
+                }
+            }
+        }
+
+        estimated_heap.take_sorted(estimated_top_);
+    }
+
+    // 相同值取平均秩
+    static std::vector<double> ranks(const std::vector<double>& values) {
+        std::vector<size_t> order(values.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return values[a] > values[b];
+        });
+
+        std::vector<double> result(values.size());
+        size_t i = 0;
+        while (i < order.size()) {
+            size_t j = i + 1;
+            while (j < order.size() && values[order[j]] == values[order[i]]) {
+                ++j;
+            }
+            double rank = (static_cast<double>(i + j - 1)) / 2.0 + 1.0;
+            for (size_t t = i; t < j; ++t) {
+                result[order[t]] = rank;
+            }
+            i = j;
+        }
+        return result;
+    }
+
+    // 秩的 Pearson 相关系数，任一侧没有方差时记为 0
+    static double spearman(const std::vector<double>& x,
+                           const std::vector<double>& y) {
+        size_t n = x.size();
+        if (n < 2) {
+            return 0.0;
+        }
+
+        std::vector<double> rx = ranks(x);
+        std::vector<double> ry = ranks(y);
+        double mean = (static_cast<double>(n) + 1.0) / 2.0;
+
+        double cov = 0.0, var_x = 0.0, var_y = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            double dx = rx[i] - mean;
+            double dy = ry[i] - mean;
+            cov += dx * dy;
+            var_x += dx * dx;
+            var_y += dy * dy;
+        }
+
+        if (var_x == 0.0 || var_y == 0.0) {
+            return 0.0;
+        }
+        return cov / std::sqrt(var_x * var_y);
+    }
+};
+
+#endif  // TOP_K_METRICS_HPP
@@ -0,0 +1,111 @@
+#ifndef TRACE_GENERATOR_H
+#define TRACE_GENERATOR_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "PacketParser.h"
+
+// 流大小分布
+enum class FlowSizeDistribution {
+    ZIPF,    // 第 r 大的流的权重为 1 / r^zipf_alpha
+    PARETO,  // 各流权重独立取自形状参数为 pareto_shape 的 Pareto 分布
+};
+
+// 合成 trace 的参数，相同参数（包括 seed）在同一可执行文件与数学库下生成
+// 逐字节相同的 trace；随机数序列与文件格式跨平台一致，但流权重经 std::pow
+// 计算，换用不同的数学库时末位舍入可能不同，抽样结果随之改变
+struct TraceConfig {
+    uint64_t seed = 1;
+    uint64_t packet_count = 1000000;
+    // 候选流的数量；每个包按权重独立抽取所属的流，
+    // 分布偏斜时权重很小的流可能一个包也没有；
+    // 各 IPv4 流的源地址互不相同，OneTuple 下也不会合并
+    uint32_t flow_count = 100000;
+
+    FlowSizeDistribution distribution = FlowSizeDistribution::ZIPF;
+    double zipf_alpha = 1.0;
+    double pareto_shape = 1.2;
+
+    // 按流划分的 IPv6 与 UDP 比例，其余为 IPv4 与 TCP
+    double ipv6_ratio = 0.0;
+    double udp_ratio = 0.0;
+
+    // 以太网帧长度（不含 FCS）在此区间内按流均匀选取，不足以容纳头部时取头部长度
+    uint16_t min_frame_length = 64;
+    uint16_t max_frame_length = 1500;
+    // 每个包写入文件的最大字节数，设为头部长度时文件只保存各层头部
+    uint32_t snap_length = 65535;
+
+    // 第一个包的时间戳与平均包速率，包间隔在 [0, 2 / 速率] 内均匀分布
+    std::chrono::nanoseconds start_time = std::chrono::seconds{1600000000};
+    uint64_t packets_per_second = 1000000;
+};
+
+// 确定性的合成流量生成器，用于可复现的解析与 sketch 基准测试
+// 构造时生成全部流及其抽样表，之后逐包生成以太网 + IPv4/IPv6 + TCP/UDP 帧；
+// 内存占用只与流数有关，与包数无关
+class TraceGenerator {
+   public:
+    // 参数非法时抛出异常
+    explicit TraceGenerator(const TraceConfig& config);
+
+    // 回到第一个包，之后生成的包序列与上一轮完全相同
+    void reset();
+
+    // 生成下一个包，全部生成完时返回 false
+    // view 指向生成器内部缓冲区，仅在下一次调用之前有效
+    bool next_packet(PacketView& view);
+
+    // 从第一个包开始生成全部包并写入纳秒精度的 libpcap 文件，写入失败时抛出异常
+    void write_pcap(const std::string& path);
+
+    // 从第一个包开始直接生成解析结果，不经过 pcap 文件；
+    // 与写出文件后调用 PacketParser::parse_pcap 的结果逐条一致
+    template <typename FlowKeyType>
+    void generate_records(std::vector<PacketRecord<FlowKeyType>>& records);
+
+    const TraceConfig& get_config() const { return config_; }
+
+   private:
+    // 以太网 + IPv6 + TCP 头部的长度，为各种组合中最长的
+    static constexpr size_t MAX_HEADER_LENGTH = 74;
+
+    struct FlowSpec {
+        // IPv4 地址，IPv6 流时为地址的低 32 位
+        uint32_t src_addr;
+        uint32_t dst_addr;
+        uint16_t src_port;
+        uint16_t dst_port;
+        uint16_t frame_length;
+        uint8_t protocol;
+        bool ipv6;
+    };
+
+    TraceConfig config_;
+    std::vector<FlowSpec> flows_;
+
+    // Walker 别名表：抽到第 i 列时以 alias_prob_[i] 的概率选 i，否则选 alias_[i]
+    std::vector<double> alias_prob_;
+    std::vector<uint32_t> alias_;
+
+    uint64_t rng_state_;
+    uint64_t emitted_;
+    std::chrono::nanoseconds clock_;
+    uint64_t max_gap_ns_;
+
+    std::vector<uint8_t> frame_;
+
+    void build_flows();
+    void build_alias_table(const std::vector<double>& weights);
+
+    uint64_t next_random();
+    double next_unit();
+    // 依次抽取下一个包所属的流和时间戳，所有输出方式共用同一抽样序列
+    const FlowSpec& draw_packet(std::chrono::nanoseconds& timestamp);
+    size_t build_frame(const FlowSpec& flow);
+};
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef TRACE_INPUT_H
+#define TRACE_INPUT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// 顺序读取的 trace 字节流
+// open 按文件头部的魔数识别 gzip / zstd 压缩，边读边解压，不落临时文件；
+// 未压缩的文件原样读取。对管道等不可寻址的输入同样适用
+class TraceInput {
+   public:
+    virtual ~TraceInput() = default;
+
+    // 读取至多 size 字节，返回实际读取的字节数，小于 size 表示已到末尾
+    // 读取或解压出错时抛出异常
+    virtual size_t read(void* dst, size_t size) = 0;
+
+    // 跳过 size 字节，数据不足时返回 false
+    bool skip(size_t size);
+
+    // 文件无法打开时返回空指针；压缩格式未编译支持时抛出异常
+    static std::unique_ptr<TraceInput> open(const std::string& filename);
+};
+
+#endif
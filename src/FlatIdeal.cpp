@@ -0,0 +1,168 @@
+#include "FlatIdeal.h"
+
+#include <algorithm>
+
+namespace {
+
+size_t round_up_pow2(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+}  // namespace
+
+template <typename FlowKeyType, typename SFINAE>
+FlatIdeal<FlowKeyType, SFINAE>::FlatIdeal(size_t expected_flows)
+    : size_(0), mask_(0) {
+    rehash(MIN_CAPACITY);
+    reserve(expected_flows);
+}
+
+template <typename FlowKeyType, typename SFINAE>
+void FlatIdeal<FlowKeyType, SFINAE>::reserve(size_t flows) {
+    size_t needed =
+        round_up_pow2(flows * MAX_LOAD_DENOMINATOR / MAX_LOAD_NUMERATOR + 1);
+    if (needed > slots_.size()) {
+        rehash(needed);
+    }
+}
+
+template <typename FlowKeyType, typename SFINAE>
+void FlatIdeal<FlowKeyType, SFINAE>::update(const FlowKeyType& flow,
+                                            int increment) {
+    add(flow, increment, home_slot(flow));
+}
+
+template <typename FlowKeyType, typename SFINAE>
+void FlatIdeal<FlowKeyType, SFINAE>::update_batch(const FlowKeyType* keys,
+                                                  const int* increments,
+                                                  size_t count) {
+    size_t homes[PREFETCH_STRIDE];
+    for (size_t base = 0; base < count; base += PREFETCH_STRIDE) {
+        size_t n = std::min(size_t{PREFETCH_STRIDE}, count - base);
+        for (size_t i = 0; i < n; ++i) {
+            homes[i] = home_slot(keys[base + i]);
+            prefetch_counter(&used_[homes[i]]);
+            prefetch_counter(&slots_[homes[i]]);
+        }
+
+        size_t mask = mask_;
+        for (size_t i = 0; i < n; ++i) {
+            const FlowKeyType& flow = keys[base + i];
+            int increment = increments ? increments[base + i] : 1;
+            // 中途扩容后先前算出的槽位失效，按新容量重新定位
+            add(flow, increment, mask == mask_ ? homes[i] : home_slot(flow));
+        }
+    }
+}
+
+template <typename FlowKeyType, typename SFINAE>
+void FlatIdeal<FlowKeyType, SFINAE>::add(const FlowKeyType& flow,
+                                         int increment,
+                                         size_t index) {
+    while (used_[index]) {
+        if (slots_[index].first == flow) {
+            uint64_t& count = slots_[index].second;
+            if (increment >= 0) {
+                count += static_cast<uint64_t>(increment);
+            } else {
+                // 负增量最多减到 0，不回绕成极大的计数
+                uint64_t decrement = static_cast<uint64_t>(-(
+                    static_cast<int64_t>(increment)));
+                count = count > decrement ? count - decrement : 0;
+            }
+            return;
+        }
+        index = (index + 1) & mask_;
+    }
+
+    // 不存在的流计数视为 0，非正的增量不会使其变化，不建表项
+    if (increment <= 0) {
+        return;
+    }
+
+    // 新流：超过负载率上限时先扩容再重新定位
+    if ((size_ + 1) * MAX_LOAD_DENOMINATOR >
+        slots_.size() * MAX_LOAD_NUMERATOR) {
+        rehash(slots_.size() * 2);
+        index = home_slot(flow);
+        while (used_[index]) {
+            index = (index + 1) & mask_;
+        }
+    }
+
+    used_[index] = 1;
+    slots_[index] = Entry(flow, static_cast<uint64_t>(increment));
+    ++size_;
+}
+
+template <typename FlowKeyType, typename SFINAE>
+uint64_t FlatIdeal<FlowKeyType, SFINAE>::query(
+    const FlowKeyType& flow) const {
+    return find(flow, home_slot(flow));
+}
+
+template <typename FlowKeyType, typename SFINAE>
+void FlatIdeal<FlowKeyType, SFINAE>::query_batch(const FlowKeyType* keys,
+                                                 size_t count,
+                                                 uint64_t* estimates) const {
+    size_t homes[PREFETCH_STRIDE];
+    for (size_t base = 0; base < count; base += PREFETCH_STRIDE) {
+        size_t n = std::min(size_t{PREFETCH_STRIDE}, count - base);
+        for (size_t i = 0; i < n; ++i) {
+            homes[i] = home_slot(keys[base + i]);
+            prefetch_counter(&used_[homes[i]]);
+            prefetch_counter(&slots_[homes[i]]);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            estimates[base + i] = find(keys[base + i], homes[i]);
+        }
+    }
+}
+
+template <typename FlowKeyType, typename SFINAE>
+uint64_t FlatIdeal<FlowKeyType, SFINAE>::find(const FlowKeyType& flow,
+                                              size_t index) const {
+    while (used_[index]) {
+        if (slots_[index].first == flow) {
+            return slots_[index].second;
+        }
+        index = (index + 1) & mask_;
+    }
+    return 0;
+}
+
+template <typename FlowKeyType, typename SFINAE>
+void FlatIdeal<FlowKeyType, SFINAE>::clear() {
+    std::fill(used_.begin(), used_.end(), 0);
+    size_ = 0;
+}
+
+template <typename FlowKeyType, typename SFINAE>
+void FlatIdeal<FlowKeyType, SFINAE>::rehash(size_t capacity) {
+    std::vector<Entry> old_slots(capacity);
+    std::vector<uint8_t> old_used(capacity, 0);
+    old_slots.swap(slots_);
+    old_used.swap(used_);
+    mask_ = capacity - 1;
+
+    for (size_t i = 0; i < old_used.size(); ++i) {
+        if (!old_used[i]) {
+            continue;
+        }
+        size_t index = home_slot(old_slots[i].first);
+        while (used_[index]) {
+            index = (index + 1) & mask_;
+        }
+        used_[index] = 1;
+        slots_[index] = old_slots[i];
+    }
+}
+
+// 显式实例化
+template class FlatIdeal<OneTuple>;
+template class FlatIdeal<TwoTuple>;
+template class FlatIdeal<FiveTuple>;
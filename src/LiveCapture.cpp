@@ -0,0 +1,346 @@
+#include "LiveCapture.h"
+
+#include <arpa/inet.h>
+#include <linux/if_packet.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+namespace {
+
+// 接收缓冲区按最大报文长度分配，超长的包按 MSG_TRUNC 截断
+constexpr size_t CAPTURE_BUFFER_SIZE = 65536;
+
+bool link_type_from_arphrd(int arphrd, pcpp::LinkLayerType& link_type) {
+    switch (arphrd) {
+        case ARPHRD_ETHER:
+        case ARPHRD_LOOPBACK:
+            link_type = pcpp::LINKTYPE_ETHERNET;
+            return true;
+        case ARPHRD_NONE:
+        case ARPHRD_PPP:
+        case ARPHRD_TUNNEL:
+        case ARPHRD_TUNNEL6:
+            // 三层隧道设备上收到的就是 IP 报文；
+            // GRE 设备（ARPHRD_IPGRE）不保证如此，与其他未知类型一样拒绝
+            link_type = pcpp::LINKTYPE_RAW;
+            return true;
+        default:
+            return false;
+    }
+}
+
+}  // namespace
+
+LiveSource::LiveSource(const std::string& interface,
+                       bool promiscuous,
+                       bool capture_outgoing)
+    : interface_(interface),
+      promiscuous_(promiscuous),
+      capture_outgoing_(capture_outgoing),
+      fd_(-1),
+      link_type_(pcpp::LINKTYPE_ETHERNET) {}
+
+LiveSource::~LiveSource() {
+    close();
+}
+
+bool LiveSource::open() {
+    unsigned int ifindex = if_nametoindex(interface_.c_str());
+    if (ifindex == 0) {
+        return false;
+    }
+
+    // 以协议号 0 创建的套接字不接收任何包，bind 指定接口和 ETH_P_ALL 后
+    // 才开始收包，不会混入 bind 之前其他接口上的包
+    fd_ = ::socket(AF_PACKET, SOCK_RAW, 0);
+    if (fd_ < 0) {
+        return false;
+    }
+
+    struct ifreq ifr;
+    std::memset(&ifr, 0, sizeof(ifr));
+    std::strncpy(ifr.ifr_name, interface_.c_str(), IFNAMSIZ - 1);
+    if (ioctl(fd_, SIOCGIFHWADDR, &ifr) != 0 ||
+        !link_type_from_arphrd(ifr.ifr_hwaddr.sa_family, link_type_)) {
+        close();
+        return false;
+    }
+
+    struct sockaddr_ll addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_ALL);
+    addr.sll_ifindex = static_cast<int>(ifindex);
+    if (bind(fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) !=
+        0) {
+        close();
+        return false;
+    }
+
+    if (promiscuous_) {
+        struct packet_mreq mreq;
+        std::memset(&mreq, 0, sizeof(mreq));
+        mreq.mr_ifindex = static_cast<int>(ifindex);
+        mreq.mr_type = PACKET_MR_PROMISC;
+        if (setsockopt(fd_, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq,
+                       sizeof(mreq)) != 0) {
+            close();
+            return false;
+        }
+    }
+
+    // 由内核在收包时打纳秒时间戳
+    int enable = 1;
+    setsockopt(fd_, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable));
+
+    buffer_.resize(CAPTURE_BUFFER_SIZE);
+    return true;
+}
+
+bool LiveSource::get_next_packet(PacketView& view, int timeout_ms) {
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::milliseconds{timeout_ms};
+
+    while (true) {
+        struct sockaddr_ll from;
+        struct iovec iov;
+        iov.iov_base = buffer_.data();
+        iov.iov_len = buffer_.size();
+
+        char control[CMSG_SPACE(sizeof(struct timespec))];
+        struct msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_name = &from;
+        msg.msg_namelen = sizeof(from);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t n = recvmsg(fd_, &msg, MSG_TRUNC | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                throw std::runtime_error(
+                    std::string("Failed to receive packet: ") +
+                    std::strerror(errno));
+            }
+
+            auto remaining = std::chrono::duration_cast<
+                std::chrono::milliseconds>(deadline -
+                                           std::chrono::steady_clock::now());
+            if (remaining.count() <= 0) {
+                return false;
+            }
+            struct pollfd pfd = {fd_, POLLIN, 0};
+            poll(&pfd, 1, static_cast<int>(remaining.count()));
+            continue;
+        }
+
+        if (!capture_outgoing_ && from.sll_pkttype == PACKET_OUTGOING) {
+            continue;
+        }
+
+        struct timespec ts = {0, 0};
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+             cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET &&
+                cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                std::memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            }
+        }
+        if (ts.tv_sec == 0 && ts.tv_nsec == 0) {
+            clock_gettime(CLOCK_REALTIME, &ts);
+        }
+
+        view.data = buffer_.data();
+        view.len = static_cast<uint32_t>(n);
+        view.caplen = static_cast<uint32_t>(
+            std::min<size_t>(static_cast<size_t>(n), buffer_.size()));
+        view.timestamp = std::chrono::seconds{ts.tv_sec} +
+                         std::chrono::nanoseconds{ts.tv_nsec};
+        view.link_type = link_type_;
+        return true;
+    }
+}
+
+void LiveSource::close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+template <typename FlowKeyType, typename SFINAE>
+LiveIngest<FlowKeyType, SFINAE>::LiveIngest(std::unique_ptr<LiveSource> source,
+                                            size_t batch_size,
+                                            size_t ring_capacity)
+    : source_(std::move(source)),
+      batch_size_(std::max<size_t>(batch_size, 1)),
+      ready_(ring_capacity),
+      recycle_(ring_capacity),
+      running_(false),
+      finished_(true),
+      packets_(0),
+      records_(0),
+      dropped_batches_(0),
+      dropped_records_(0) {}
+
+template <typename FlowKeyType, typename SFINAE>
+LiveIngest<FlowKeyType, SFINAE>::~LiveIngest() {
+    stop();
+}
+
+template <typename FlowKeyType, typename SFINAE>
+void LiveIngest<FlowKeyType, SFINAE>::start(
+    std::chrono::milliseconds flush_interval) {
+    if (running_.load()) {
+        return;
+    }
+    // 采集线程出错退出后 running_ 已清除，线程仍需回收
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    running_.store(true);
+    finished_.store(false);
+    thread_ = std::thread(&LiveIngest::capture_loop, this, flush_interval);
+}
+
+template <typename FlowKeyType, typename SFINAE>
+void LiveIngest<FlowKeyType, SFINAE>::stop() {
+    running_.store(false);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+template <typename FlowKeyType, typename SFINAE>
+void LiveIngest<FlowKeyType, SFINAE>::capture_loop(
+    std::chrono::milliseconds flush_interval) {
+    PacketVector batch;
+    batch.reserve(batch_size_);
+    auto last_flush = std::chrono::steady_clock::now();
+    int poll_ms = static_cast<int>(
+        std::max<std::chrono::milliseconds::rep>(flush_interval.count(), 1));
+
+    PacketView view;
+    while (running_.load(std::memory_order_relaxed)) {
+        bool received;
+        try {
+            received = source_->get_next_packet(view, poll_ms);
+        } catch (...) {
+            // 读取出错时结束采集，由消费线程在取完剩余批次后重新抛出
+            error_ = std::current_exception();
+            break;
+        }
+
+        if (received) {
+            packets_.fetch_add(1, std::memory_order_relaxed);
+
+            FlowKeyType flow = PacketParser<FlowKeyType>::parse_packet(view);
+            if (!(flow == FlowKeyType())) {
+                PacketRecordType record;
+                record.flow = flow;
+                record.timestamp = view.timestamp;
+                record.length = view.len;
+                batch.push_back(record);
+                records_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (batch.size() >= batch_size_ ||
+            (!batch.empty() && now - last_flush >= flush_interval)) {
+            publish(batch);
+            last_flush = now;
+        }
+    }
+
+    // 最后一批在队列满时最多等待一个 flush_interval，仍放不下则计入丢弃
+    if (!batch.empty()) {
+        auto deadline = std::chrono::steady_clock::now() + flush_interval;
+        while (ready_.full() && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::microseconds{50});
+        }
+        publish(batch);
+    }
+    // 出错退出时 stop 尚未被调用，在这里清除运行标志
+    running_.store(false);
+    finished_.store(true, std::memory_order_release);
+}
+
+template <typename FlowKeyType, typename SFINAE>
+void LiveIngest<FlowKeyType, SFINAE>::publish(PacketVector& batch) {
+    if (!ready_.try_push(batch)) {
+        // 消费端跟不上时丢弃整批，不阻塞采集线程
+        dropped_batches_.fetch_add(1, std::memory_order_relaxed);
+        dropped_records_.fetch_add(batch.size(), std::memory_order_relaxed);
+        batch.clear();
+        return;
+    }
+
+    // 优先复用消费端还回来的缓冲区
+    if (!recycle_.try_pop(batch)) {
+        batch = PacketVector();
+        batch.reserve(batch_size_);
+    }
+    batch.clear();
+}
+
+template <typename FlowKeyType, typename SFINAE>
+bool LiveIngest<FlowKeyType, SFINAE>::next_batch(
+    PacketVector& batch,
+    std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    while (true) {
+        PacketVector next;
+        if (ready_.try_pop(next)) {
+            // 旧缓冲区还给采集线程，队列满时直接释放
+            batch.clear();
+            recycle_.try_push(batch);
+            batch.swap(next);
+            return true;
+        }
+        if (finished_.load(std::memory_order_acquire) && ready_.empty()) {
+            if (error_) {
+                std::exception_ptr error = error_;
+                error_ = nullptr;
+                std::rethrow_exception(error);
+            }
+            return false;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds{50});
+    }
+}
+
+template <typename FlowKeyType, typename SFINAE>
+typename LiveIngest<FlowKeyType, SFINAE>::Stats
+LiveIngest<FlowKeyType, SFINAE>::get_stats() const {
+    Stats stats;
+    stats.packets = packets_.load(std::memory_order_relaxed);
+    stats.records = records_.load(std::memory_order_relaxed);
+    stats.dropped_batches = dropped_batches_.load(std::memory_order_relaxed);
+    stats.dropped_records = dropped_records_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+// 显式实例化
+template class LiveIngest<OneTuple>;
+template class LiveIngest<TwoTuple>;
+template class LiveIngest<FiveTuple>;
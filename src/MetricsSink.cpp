@@ -0,0 +1,217 @@
+#include "MetricsSink.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+bool ends_with(const std::string& value, const std::string& suffix) {
+    return value.size() >= suffix.size() &&
+           value.compare(value.size() - suffix.size(), suffix.size(),
+                         suffix) == 0;
+}
+
+void append_number(double value, std::string& out, const char* missing) {
+    if (!std::isfinite(value)) {
+        out += missing;
+        return;
+    }
+    // 计数类指标按整数原样输出；其余取能还原出同一 double 的最短写法
+    char text[32];
+    int length;
+    if (value == std::trunc(value) && std::fabs(value) < 1e18) {
+        length = std::snprintf(text, sizeof(text), "%.0f", value);
+    } else {
+        length = std::snprintf(text, sizeof(text), "%.15g", value);
+        if (std::strtod(text, nullptr) != value) {
+            length = std::snprintf(text, sizeof(text), "%.17g", value);
+        }
+    }
+    out.append(text, static_cast<size_t>(length));
+}
+
+// 含逗号、引号或换行的字段加引号，内部引号写两遍
+void append_csv_field(const std::string& field, std::string& out) {
+    if (field.find_first_of(",\"\r\n") == std::string::npos) {
+        out += field;
+        return;
+    }
+    out += '"';
+    for (char c : field) {
+        if (c == '"') {
+            out += '"';
+        }
+        out += c;
+    }
+    out += '"';
+}
+
+void append_json_string(const std::string& value, std::string& out) {
+    out += '"';
+    for (char c : value) {
+        switch (c) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x",
+                                  static_cast<unsigned>(c));
+                    out += escaped;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+}  // namespace
+
+MetricsSink::MetricsSink(const std::string& path,
+                         Format format,
+                         std::vector<std::string> label_columns,
+                         std::vector<std::string> value_columns,
+                         size_t buffer_size)
+    : file_(std::fopen(path.c_str(), "ab")),
+      format_(format),
+      label_columns_(std::move(label_columns)),
+      value_columns_(std::move(value_columns)),
+      buffer_size_(buffer_size) {
+    if (!file_) {
+        throw std::runtime_error("无法打开指标输出文件: " + path);
+    }
+    buffer_.reserve(buffer_size_);
+
+    // 追加到已有文件时不重复写表头
+    std::fseek(file_, 0, SEEK_END);
+    if (format_ == Format::CSV && std::ftell(file_) == 0) {
+        bool first = true;
+        for (const auto* columns : {&label_columns_, &value_columns_}) {
+            for (const auto& column : *columns) {
+                if (!first) {
+                    buffer_ += ',';
+                }
+                append_csv_field(column, buffer_);
+                first = false;
+            }
+        }
+        buffer_ += '\n';
+    }
+}
+
+// 析构时的写入失败无法上报，需要确认结果时先显式调用 flush()
+MetricsSink::~MetricsSink() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flush_locked();
+    std::fclose(file_);
+}
+
+MetricsSink::Format MetricsSink::format_from_path(const std::string& path) {
+    return ends_with(path, ".jsonl") || ends_with(path, ".json")
+               ? Format::JSON_LINES
+               : Format::CSV;
+}
+
+void MetricsSink::write(const std::vector<std::string>& labels,
+                        const std::vector<double>& values) {
+    if (values.size() != value_columns_.size()) {
+        throw std::runtime_error("指标数量与列数不一致");
+    }
+    write(labels, values.data());
+}
+
+void MetricsSink::write(const std::vector<std::string>& labels,
+                        const double* values) {
+    if (labels.size() != label_columns_.size()) {
+        throw std::runtime_error("标签数量与列数不一致");
+    }
+
+    // 在锁外完成格式化
+    std::string line;
+    if (format_ == Format::CSV) {
+        format_csv(labels, values, line);
+    } else {
+        format_json(labels, values, line);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffer_ += line;
+    if (buffer_.size() >= buffer_size_ && !flush_locked()) {
+        throw std::runtime_error("写入指标文件失败");
+    }
+}
+
+void MetricsSink::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!flush_locked()) {
+        throw std::runtime_error("写入指标文件失败");
+    }
+}
+
+void MetricsSink::format_csv(const std::vector<std::string>& labels,
+                             const double* values,
+                             std::string& line) const {
+    for (size_t i = 0; i < labels.size(); ++i) {
+        if (i > 0) {
+            line += ',';
+        }
+        append_csv_field(labels[i], line);
+    }
+    for (size_t i = 0; i < value_columns_.size(); ++i) {
+        if (i > 0 || !labels.empty()) {
+            line += ',';
+        }
+        append_number(values[i], line, "");
+    }
+    line += '\n';
+}
+
+void MetricsSink::format_json(const std::vector<std::string>& labels,
+                              const double* values,
+                              std::string& line) const {
+    line += '{';
+    for (size_t i = 0; i < labels.size(); ++i) {
+        if (i > 0) {
+            line += ',';
+        }
+        append_json_string(label_columns_[i], line);
+        line += ':';
+        append_json_string(labels[i], line);
+    }
+    for (size_t i = 0; i < value_columns_.size(); ++i) {
+        if (i > 0 || !labels.empty()) {
+            line += ',';
+        }
+        append_json_string(value_columns_[i], line);
+        line += ':';
+        append_number(values[i], line, "null");
+    }
+    line += "}\n";
+}
+
+bool MetricsSink::flush_locked() {
+    if (buffer_.empty()) {
+        return true;
+    }
+    size_t written = std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+    bool ok = written == buffer_.size() && std::fflush(file_) == 0;
+    buffer_.clear();
+    return ok;
+}
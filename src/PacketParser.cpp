@@ -1,4 +1,16 @@
 #include "PacketParser.h"
+#include "RecordCache.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <thread>
 
 uint32_t ip_string_to_uint32(const std::string& ip_str) {
     uint32_t result = 0;
@@ -49,6 +61,32 @@ constexpr uint32_t MAGIC_MICROSECONDS_BE = 0xd4c3b2a1;
 constexpr uint32_t MAGIC_NANOSECONDS_LE = 0xa1b23c4d;
 constexpr uint32_t MAGIC_NANOSECONDS_BE = 0x4d3cb2a1;
 
+// pcapng 块类型
+constexpr uint32_t PCAPNG_SECTION_HEADER = 0x0a0d0d0a;
+constexpr uint32_t PCAPNG_BYTE_ORDER_MAGIC = 0x1a2b3c4d;
+constexpr uint32_t PCAPNG_INTERFACE_DESCRIPTION = 1;
+constexpr uint32_t PCAPNG_OBSOLETE_PACKET = 2;
+constexpr uint32_t PCAPNG_SIMPLE_PACKET = 3;
+constexpr uint32_t PCAPNG_ENHANCED_PACKET = 6;
+// 节头块最小长度：类型、长度、字节序魔数、版本号、节长度、尾部长度
+constexpr uint32_t PCAPNG_MIN_SECTION_HEADER_LEN = 28;
+// 块长度上限，远大于任何合法的包块，避免损坏的长度字段触发数 GB 的分配
+constexpr uint32_t PCAPNG_MAX_BLOCK_LEN = 16 * 1024 * 1024;
+// if_tsresol 上限：二进制精度 2^-63 秒、十进制精度 10^-19 秒，
+// 再大则单位换算溢出 64 位
+constexpr uint8_t PCAPNG_MAX_BINARY_RESOLUTION = 63;
+constexpr uint8_t PCAPNG_MAX_DECIMAL_RESOLUTION = 19;
+
+// pcapng 选项
+constexpr uint16_t PCAPNG_OPT_END = 0;
+constexpr uint16_t PCAPNG_OPT_IF_TSRESOL = 9;
+constexpr uint16_t PCAPNG_OPT_IF_TSOFFSET = 14;
+
+inline bool is_pcap_magic(uint32_t magic) {
+    return magic == MAGIC_MICROSECONDS_LE || magic == MAGIC_MICROSECONDS_BE ||
+           magic == MAGIC_NANOSECONDS_LE || magic == MAGIC_NANOSECONDS_BE;
+}
+
 #pragma pack(push, 1)
 struct PcapFileHeader {
     uint32_t magic_number;
@@ -68,27 +106,149 @@ struct PcapPacketHeader {
 };
 #pragma pack(pop)
 
+// 读取记录头并转换为主机字节序
+inline PcapPacketHeader load_packet_header(const void* src, bool big_endian) {
+    PcapPacketHeader header;
+    std::memcpy(&header, src, sizeof(header));
+    if (big_endian) {
+        header.ts_sec = swap_bytes32(header.ts_sec);
+        header.ts_usec = swap_bytes32(header.ts_usec);
+        header.incl_len = swap_bytes32(header.incl_len);
+        header.orig_len = swap_bytes32(header.orig_len);
+    }
+    return header;
+}
+
+inline bool is_invalid_record(const PcapPacketHeader& header) {
+    return header.incl_len == 0 || header.incl_len > PCPP_MAX_PACKET_SIZE;
+}
+
+inline uint16_t load_u16(const uint8_t* src, bool swap) {
+    uint16_t value;
+    std::memcpy(&value, src, sizeof(value));
+    return swap ? swap_bytes16(value) : value;
+}
+
+inline uint32_t load_u32(const uint8_t* src, bool swap) {
+    uint32_t value;
+    std::memcpy(&value, src, sizeof(value));
+    return swap ? swap_bytes32(value) : value;
+}
+
+inline std::chrono::nanoseconds to_timestamp(const PcapPacketHeader& header,
+                                             bool nano_precision) {
+    uint64_t sub_second = nano_precision ? header.ts_usec
+                                         : uint64_t{header.ts_usec} * 1000;
+    return std::chrono::seconds{header.ts_sec} +
+           std::chrono::nanoseconds{sub_second};
+}
+
 }  // namespace
 
-PcapReader::PcapReader(const std::string& filename)
+PcapReader::PcapReader(const std::string& filename, bool use_mmap)
     : filename_(filename),
+      use_mmap_(use_mmap),
+      is_pcapng_(false),
       is_big_endian_(false),
       has_nano_precision_(false),
-      link_type_(pcpp::LINKTYPE_ETHERNET) {}
+      link_type_(pcpp::LINKTYPE_ETHERNET),
+      has_last_timestamp_(false),
+      last_timestamp_(0),
+      untimed_packets_(0),
+      mapped_data_(nullptr),
+      mapped_size_(0),
+      offset_(0),
+      released_(0) {}
 
 PcapReader::~PcapReader() {
     close();
 }
 
-bool PcapReader::open() {
-    file_.open(filename_, std::ios::binary);
-    if (!file_) {
+bool PcapReader::map_file() {
+    int fd = ::open(filename_.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    // 只映射普通文件，管道、设备等交给流式读取
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        ::close(fd);
         return false;
     }
 
+    size_t size = static_cast<size_t>(st.st_size);
+    void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+
+    madvise(addr, size, MADV_SEQUENTIAL);
+
+    mapped_data_ = static_cast<const uint8_t*>(addr);
+    mapped_size_ = size;
+    offset_ = 0;
+    released_ = 0;
+    return true;
+}
+
+void PcapReader::unmap_file() {
+    if (mapped_data_) {
+        munmap(const_cast<uint8_t*>(mapped_data_), mapped_size_);
+        mapped_data_ = nullptr;
+        mapped_size_ = 0;
+        offset_ = 0;
+        released_ = 0;
+    }
+}
+
+bool PcapReader::read_header(void* dst, size_t size) {
+    if (is_mapped()) {
+        if (mapped_size_ - offset_ < size) {
+            return false;
+        }
+        std::memcpy(dst, mapped_data_ + offset_, size);
+        offset_ += size;
+        return true;
+    }
+
+    return input_->read(dst, size) == size;
+}
+
+bool PcapReader::open() {
+    // 只有未压缩的 libpcap 文件走 mmap，其余情况回退到流式读取
+    if (use_mmap_ && map_file()) {
+        uint32_t magic = 0;
+        if (mapped_size_ >= sizeof(PcapFileHeader)) {
+            std::memcpy(&magic, mapped_data_, sizeof(magic));
+        }
+        if (!is_pcap_magic(magic)) {
+            unmap_file();
+        }
+    }
+    if (!is_mapped()) {
+        input_ = TraceInput::open(filename_);
+        if (!input_) {
+            return false;
+        }
+    }
+
     PcapFileHeader header;
-    file_.read(reinterpret_cast<char*>(&header), sizeof(header));
-    if (!file_) {
+    if (!read_header(&header.magic_number, sizeof(header.magic_number))) {
+        return false;
+    }
+
+    if (header.magic_number == PCAPNG_SECTION_HEADER) {
+        uint8_t fields[8];
+        is_pcapng_ = true;
+        return read_header(fields, sizeof(fields)) &&
+               read_section_header(fields);
+    }
+
+    if (!read_header(reinterpret_cast<uint8_t*>(&header) +
+                         sizeof(header.magic_number),
+                     sizeof(header) - sizeof(header.magic_number))) {
         return false;
     }
 
@@ -124,120 +284,818 @@ bool PcapReader::open() {
     return true;
 }
 
-bool PcapReader::get_next_packet(pcpp::RawPacket& raw_packet) {
-    raw_packet.clear();
+bool PcapReader::get_next_packet(PacketView& view) {
+    if (is_mapped()) {
+        return get_packet_at(offset_, mapped_size_, view);
+    }
+    if (is_pcapng_) {
+        return get_next_pcapng_packet(view);
+    }
 
     while (true) {
         PcapPacketHeader pkt_header;
-        file_.read(reinterpret_cast<char*>(&pkt_header), sizeof(pkt_header));
-        if (!file_ || file_.gcount() == 0) {
+        // 末尾不足一个记录头（抓包进程被终止、文件轮转等）按文件结束处理，
+        // 与原先的行为一致；只有记录头完整而包数据不全时才抛出异常
+        if (!read_header(&pkt_header, sizeof(pkt_header))) {
             return false;
         }
-        if (file_.gcount() != sizeof(pkt_header)) {
-            throw std::runtime_error("Incomplete packet header");
+        pkt_header = load_packet_header(&pkt_header, is_big_endian_);
+
+        // 跳过无效包
+        if (is_invalid_record(pkt_header)) {
+            if (!input_->skip(pkt_header.incl_len)) {
+                return false;
+            }
+            continue;
         }
 
-        if (is_big_endian_) {
-            pkt_header.ts_sec = swap_bytes32(pkt_header.ts_sec);
-            pkt_header.ts_usec = swap_bytes32(pkt_header.ts_usec);
-            pkt_header.incl_len = swap_bytes32(pkt_header.incl_len);
-            pkt_header.orig_len = swap_bytes32(pkt_header.orig_len);
+        if (buffer_.size() < pkt_header.incl_len) {
+            buffer_.resize(pkt_header.incl_len);
+        }
+        if (input_->read(buffer_.data(), pkt_header.incl_len) !=
+            pkt_header.incl_len) {
+            throw std::runtime_error("Incomplete packet data");
         }
 
-        // 跳过无效包
-        if (pkt_header.incl_len == 0 ||
-            pkt_header.incl_len > PCPP_MAX_PACKET_SIZE) {
-            file_.seekg(pkt_header.incl_len, std::ios::cur);
+        view.data = buffer_.data();
+        view.caplen = pkt_header.incl_len;
+        view.len = pkt_header.orig_len;
+        view.timestamp = to_timestamp(pkt_header, has_nano_precision_);
+        view.link_type = link_type_;
+        return true;
+    }
+}
+
+bool PcapReader::read_section_header(const uint8_t* fields) {
+    uint32_t byte_order = load_u32(fields + 4, false);
+    if (byte_order == PCAPNG_BYTE_ORDER_MAGIC) {
+        is_big_endian_ = false;
+    } else if (byte_order == swap_bytes32(PCAPNG_BYTE_ORDER_MAGIC)) {
+        is_big_endian_ = true;
+    } else {
+        return false;
+    }
+
+    uint32_t block_length = load_u32(fields, is_big_endian_);
+    if (block_length < PCAPNG_MIN_SECTION_HEADER_LEN || block_length % 4 != 0) {
+        return false;
+    }
+
+    // 接口编号只在本节内有效
+    interfaces_.clear();
+    has_last_timestamp_ = false;
+    // 类型、长度和字节序魔数三个字段已经读出
+    return input_->skip(block_length - 3 * sizeof(uint32_t));
+}
+
+void PcapReader::add_pcapng_interface(const uint8_t* body, size_t size) {
+    PcapngInterface interface{pcpp::LINKTYPE_ETHERNET, false, 6, 0};
+
+    uint16_t link_type = load_u16(body, is_big_endian_);
+    if (pcpp::RawPacket::isLinkTypeValid(link_type)) {
+        interface.link_type = static_cast<pcpp::LinkLayerType>(link_type);
+    }
+
+    // 链路层类型、保留字段与 snaplen 之后是选项列表
+    size_t offset = 8;
+    while (size - offset >= 4) {
+        uint16_t code = load_u16(body + offset, is_big_endian_);
+        uint16_t length = load_u16(body + offset + 2, is_big_endian_);
+        offset += 4;
+        if (code == PCAPNG_OPT_END || size - offset < length) {
+            break;
+        }
+
+        if (code == PCAPNG_OPT_IF_TSRESOL && length >= 1) {
+            interface.binary_resolution = (body[offset] & 0x80) != 0;
+            interface.resolution = body[offset] & 0x7f;
+            if (interface.resolution >
+                (interface.binary_resolution ? PCAPNG_MAX_BINARY_RESOLUTION
+                                             : PCAPNG_MAX_DECIMAL_RESOLUTION)) {
+                throw std::runtime_error(
+                    "Invalid pcapng timestamp resolution");
+            }
+        } else if (code == PCAPNG_OPT_IF_TSOFFSET && length >= 8) {
+            uint64_t value;
+            std::memcpy(&value, body + offset, sizeof(value));
+            if (is_big_endian_) {
+                value = (uint64_t{swap_bytes32(static_cast<uint32_t>(value))}
+                         << 32) |
+                        swap_bytes32(static_cast<uint32_t>(value >> 32));
+            }
+            interface.offset_seconds = static_cast<int64_t>(value);
+        }
+        offset += (length + 3u) & ~3u;
+    }
+
+    if (interfaces_.empty()) {
+        link_type_ = interface.link_type;
+    }
+    interfaces_.push_back(interface);
+}
+
+namespace {
+
+// 把 pcapng 时间戳换算为纳秒
+std::chrono::nanoseconds pcapng_timestamp(uint64_t ticks,
+                                          bool binary_resolution,
+                                          uint8_t resolution,
+                                          int64_t offset_seconds) {
+    constexpr uint64_t NANOS_PER_SECOND = 1000000000;
+    uint64_t seconds;
+    uint64_t nanos;
+
+    // resolution 已在解析接口描述块时检查过上限
+    if (binary_resolution) {
+        // 超过 2^-32 秒的精度对纳秒时间戳没有意义
+        uint8_t shift = std::min<uint8_t>(resolution, 32);
+        ticks >>= resolution - shift;
+        seconds = ticks >> shift;
+        uint64_t fraction = ticks & ((uint64_t{1} << shift) - 1);
+        nanos = (fraction * NANOS_PER_SECOND) >> shift;
+    } else {
+        uint64_t unit = 1;
+        for (uint8_t i = 0; i < resolution; ++i) {
+            unit *= 10;
+        }
+        seconds = ticks / unit;
+        uint64_t fraction = ticks % unit;
+        if (unit <= NANOS_PER_SECOND) {
+            nanos = fraction * (NANOS_PER_SECOND / unit);
+        } else {
+            nanos = fraction / (unit / NANOS_PER_SECOND);
+        }
+    }
+
+    return std::chrono::seconds{static_cast<int64_t>(seconds) +
+                                offset_seconds} +
+           std::chrono::nanoseconds{nanos};
+}
+
+}  // namespace
+
+bool PcapReader::get_next_pcapng_packet(PacketView& view) {
+    while (true) {
+        uint8_t block_header[8];
+        if (!read_header(block_header, sizeof(block_header))) {
+            return false;
+        }
+
+        // 新的节头块可能切换字节序，其类型值是回文，不受字节序影响
+        uint32_t block_type = load_u32(block_header, is_big_endian_);
+        if (block_type == PCAPNG_SECTION_HEADER) {
+            // 块长度要按新节的字节序解释，先补读字节序魔数
+            uint8_t fields[8];
+            std::memcpy(fields, block_header + 4, 4);
+            if (!read_header(fields + 4, 4)) {
+                return false;
+            }
+            if (!read_section_header(fields)) {
+                throw std::runtime_error("Invalid pcapng section header");
+            }
             continue;
         }
 
-        std::unique_ptr<uint8_t[]> packet_data(
-            new uint8_t[pkt_header.incl_len]);
-        file_.read(reinterpret_cast<char*>(packet_data.get()),
-                   pkt_header.incl_len);
-        if (!file_ ||
-            static_cast<uint32_t>(file_.gcount()) != pkt_header.incl_len) {
+        uint32_t block_length = load_u32(block_header + 4, is_big_endian_);
+        if (block_length < 12 || block_length % 4 != 0 ||
+            block_length > PCAPNG_MAX_BLOCK_LEN) {
+            throw std::runtime_error("Invalid pcapng block length");
+        }
+
+        // 读出块体和尾部长度字段
+        size_t body_size = block_length - sizeof(block_header) - 4;
+        if (buffer_.size() < body_size + 4) {
+            buffer_.resize(body_size + 4);
+        }
+        if (input_->read(buffer_.data(), body_size + 4) != body_size + 4) {
             throw std::runtime_error("Incomplete packet data");
         }
+        const uint8_t* body = buffer_.data();
+
+        uint32_t interface_id = 0;
+        uint64_t ticks = 0;
+        uint32_t caplen = 0;
+        uint32_t len = 0;
+        size_t data_offset = 0;
+
+        switch (block_type) {
+            case PCAPNG_INTERFACE_DESCRIPTION:
+                if (body_size >= 8) {
+                    add_pcapng_interface(body, body_size);
+                }
+                continue;
+            case PCAPNG_ENHANCED_PACKET:
+                if (body_size < 20) {
+                    continue;
+                }
+                interface_id = load_u32(body, is_big_endian_);
+                ticks = (uint64_t{load_u32(body + 4, is_big_endian_)} << 32) |
+                        load_u32(body + 8, is_big_endian_);
+                caplen = load_u32(body + 12, is_big_endian_);
+                len = load_u32(body + 16, is_big_endian_);
+                data_offset = 20;
+                break;
+            case PCAPNG_OBSOLETE_PACKET:
+                if (body_size < 20) {
+                    continue;
+                }
+                interface_id = load_u16(body, is_big_endian_);
+                ticks = (uint64_t{load_u32(body + 4, is_big_endian_)} << 32) |
+                        load_u32(body + 8, is_big_endian_);
+                caplen = load_u32(body + 12, is_big_endian_);
+                len = load_u32(body + 16, is_big_endian_);
+                data_offset = 20;
+                break;
+            case PCAPNG_SIMPLE_PACKET:
+                // 简单包块不带时间戳，捕获长度由块长度推出
+                if (body_size < 4) {
+                    continue;
+                }
+                len = load_u32(body, is_big_endian_);
+                caplen = static_cast<uint32_t>(
+                    std::min<size_t>(len, body_size - 4));
+                data_offset = 4;
+                break;
+            default:
+                // 名称解析、统计等其他块不含数据包
+                continue;
+        }
+
+        // 跳过无效包
+        if (interface_id >= interfaces_.size() || caplen == 0 ||
+            caplen > PCPP_MAX_PACKET_SIZE || caplen > body_size - data_offset) {
+            continue;
+        }
 
-        bool success;
-        if (has_nano_precision_) {
-            timespec ts;
-            ts.tv_sec = static_cast<time_t>(pkt_header.ts_sec);
-            ts.tv_nsec = static_cast<long>(pkt_header.ts_usec);
-            success = raw_packet.setRawData(
-                packet_data.get(), static_cast<int>(pkt_header.incl_len), ts,
-                link_type_, static_cast<int>(pkt_header.orig_len));
+        const PcapngInterface& interface = interfaces_[interface_id];
+        if (block_type == PCAPNG_SIMPLE_PACKET) {
+            if (!has_last_timestamp_) {
+                ++untimed_packets_;
+                continue;
+            }
+            view.timestamp = last_timestamp_;
         } else {
-            timeval tv;
-            tv.tv_sec = static_cast<long>(pkt_header.ts_sec);
-            tv.tv_usec = static_cast<long>(pkt_header.ts_usec);
-            success = raw_packet.setRawData(
-                packet_data.get(), static_cast<int>(pkt_header.incl_len), tv,
-                link_type_, static_cast<int>(pkt_header.orig_len));
+            view.timestamp = pcapng_timestamp(ticks,
+                                              interface.binary_resolution,
+                                              interface.resolution,
+                                              interface.offset_seconds);
+            last_timestamp_ = view.timestamp;
+            has_last_timestamp_ = true;
         }
+        view.data = body + data_offset;
+        view.caplen = caplen;
+        view.len = len;
+        view.link_type = interface.link_type;
+        return true;
+    }
+}
 
-        if (!success) {
-            throw std::runtime_error("Failed to set raw packet data");
+bool PcapReader::get_packet_at(size_t& offset,
+                               size_t end,
+                               PacketView& view) const {
+    while (offset < end &&
+           mapped_size_ - offset >= sizeof(PcapPacketHeader)) {
+        PcapPacketHeader pkt_header =
+            load_packet_header(mapped_data_ + offset, is_big_endian_);
+        offset += sizeof(pkt_header);
+
+        // 跳过无效包
+        if (is_invalid_record(pkt_header)) {
+            offset += std::min<size_t>(pkt_header.incl_len,
+                                       mapped_size_ - offset);
+            continue;
         }
 
-        packet_data.release();
+        if (mapped_size_ - offset < pkt_header.incl_len) {
+            throw std::runtime_error("Incomplete packet data");
+        }
+
+        view.data = mapped_data_ + offset;
+        view.caplen = pkt_header.incl_len;
+        view.len = pkt_header.orig_len;
+        view.timestamp = to_timestamp(pkt_header, has_nano_precision_);
+        view.link_type = link_type_;
+
+        offset += pkt_header.incl_len;
         return true;
     }
+    // 文件末尾残留不足一个记录头的字节时按文件结束处理，与流式读取一致
+    return false;
+}
+
+void PcapReader::release_consumed() {
+    if (!is_mapped()) {
+        return;
+    }
+
+    static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t consumed = offset_ / page_size * page_size;
+    if (consumed > released_) {
+        madvise(const_cast<uint8_t*>(mapped_data_) + released_,
+                consumed - released_, MADV_DONTNEED);
+        released_ = consumed;
+    }
+}
+
+std::vector<size_t> PcapReader::split_chunks(size_t chunk_count) const {
+    std::vector<size_t> boundaries;
+    if (!is_mapped()) {
+        return boundaries;
+    }
+
+    // 只读取记录头中的长度字段，沿记录链跳跃
+    size_t offset = sizeof(PcapFileHeader);
+    size_t chunk_bytes =
+        (mapped_size_ - offset) / std::max<size_t>(chunk_count, 1) + 1;
+    size_t next_boundary = offset + chunk_bytes;
+
+    boundaries.push_back(offset);
+    while (mapped_size_ - offset >= sizeof(PcapPacketHeader)) {
+        if (offset >= next_boundary) {
+            boundaries.push_back(offset);
+            next_boundary = offset + chunk_bytes;
+        }
+
+        uint32_t incl_len;
+        std::memcpy(
+            &incl_len,
+            mapped_data_ + offset + offsetof(PcapPacketHeader, incl_len),
+            sizeof(incl_len));
+        if (is_big_endian_) {
+            incl_len = swap_bytes32(incl_len);
+        }
+
+        offset += sizeof(PcapPacketHeader);
+        offset += std::min<size_t>(incl_len, mapped_size_ - offset);
+    }
+    boundaries.push_back(mapped_size_);
+
+    return boundaries;
+}
+
+bool PcapReader::get_next_packet(pcpp::RawPacket& raw_packet) {
+    raw_packet.clear();
+
+    PacketView view;
+    if (!get_next_packet(view)) {
+        return false;
+    }
+
+    // RawPacket 接管数据所有权，这里需要一份独立拷贝
+    std::unique_ptr<uint8_t[]> packet_data(new uint8_t[view.caplen]);
+    std::memcpy(packet_data.get(), view.data, view.caplen);
+
+    timespec ts;
+    ts.tv_sec = static_cast<time_t>(
+        std::chrono::duration_cast<std::chrono::seconds>(view.timestamp)
+            .count());
+    ts.tv_nsec = static_cast<long>(view.timestamp.count() % 1000000000);
+
+    if (!raw_packet.setRawData(packet_data.get(),
+                               static_cast<int>(view.caplen), ts,
+                               view.link_type, static_cast<int>(view.len))) {
+        throw std::runtime_error("Failed to set raw packet data");
+    }
+
+    packet_data.release();
+    return true;
 }
 
 void PcapReader::close() {
-    if (file_.is_open()) {
-        file_.close();
+    unmap_file();
+    input_.reset();
+}
+
+// 报头快速解析
+namespace {
+
+constexpr size_t ETH_HEADER_LEN = 14;
+constexpr size_t IPV4_MIN_HEADER_LEN = 20;
+constexpr size_t IPV6_HEADER_LEN = 40;
+constexpr uint16_t ETHERTYPE_IPV4 = 0x0800;
+constexpr uint16_t ETHERTYPE_IPV6 = 0x86dd;
+constexpr uint16_t ETHERTYPE_ARP = 0x0806;
+constexpr uint16_t ETHERTYPE_VLAN = 0x8100;
+constexpr uint16_t ETHERTYPE_QINQ = 0x88a8;
+constexpr uint16_t ETHERTYPE_QINQ_LEGACY = 0x9100;
+constexpr uint16_t ETHERTYPE_MPLS_UNICAST = 0x8847;
+constexpr uint16_t ETHERTYPE_MPLS_MULTICAST = 0x8848;
+constexpr uint16_t ETHERTYPE_MIN = 0x0600;  // 小于该值为 802.3 长度字段
+
+constexpr size_t VLAN_TAG_LEN = 4;
+constexpr int MAX_VLAN_TAGS = 4;
+constexpr size_t MPLS_LABEL_LEN = 4;
+constexpr int MAX_MPLS_LABELS = 8;
+
+// Linux cooked capture，协议字段即以太类型
+constexpr size_t SLL_HEADER_LEN = 16;
+constexpr size_t SLL_PROTOCOL_OFFSET = 14;
+constexpr size_t SLL2_HEADER_LEN = 20;
+constexpr size_t SLL2_PROTOCOL_OFFSET = 0;
+// BSD loopback，4 字节地址族之后直接是网络层
+constexpr size_t NULL_HEADER_LEN = 4;
+
+// IPv6 扩展头
+constexpr uint8_t IPV6_EXT_HOP_BY_HOP = 0;
+constexpr uint8_t IPV6_EXT_ROUTING = 43;
+constexpr uint8_t IPV6_EXT_FRAGMENT = 44;
+constexpr uint8_t IPV6_EXT_AUTH = 51;
+constexpr uint8_t IPV6_EXT_DEST_OPTIONS = 60;
+constexpr int IPV6_MAX_EXTENSIONS = 8;
+
+inline uint16_t load_be16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+// 保持网络字节序，与 pcpp::IPv4Address::toInt 一致
+inline uint32_t load_raw32(const uint8_t* p) {
+    uint32_t val;
+    std::memcpy(&val, p, sizeof(val));
+    return val;
+}
+
+// IP 报头位置，len 为报头起始到捕获末尾的长度
+struct IpHeader {
+    const uint8_t* data = nullptr;
+    size_t len = 0;
+    bool is_ipv6 = false;
+};
+
+// 校验并记录 IPv4/IPv6 报头，版本不符或长度不足时保持为空
+inline void set_ip_header(const uint8_t* data, size_t len, IpHeader& ip) {
+    if (len == 0) {
+        return;
+    }
+
+    uint8_t version = data[0] >> 4;
+    if (version == 4 && len >= IPV4_MIN_HEADER_LEN && (data[0] & 0x0F) >= 5) {
+        ip.data = data;
+        ip.len = len;
+        ip.is_ipv6 = false;
+    } else if (version == 6 && len >= IPV6_HEADER_LEN) {
+        ip.data = data;
+        ip.len = len;
+        ip.is_ipv6 = true;
+    }
+}
+
+// 只认指定版本的 IP 报头
+inline void set_ip_header(const uint8_t* data,
+                          size_t len,
+                          bool is_ipv6,
+                          IpHeader& ip) {
+    set_ip_header(data, len, ip);
+    if (ip.data && ip.is_ipv6 != is_ipv6) {
+        ip = IpHeader();
+    }
+}
+
+// 逐个弹出 MPLS 标签直到栈底，栈底之下没有协议字段，按版本号判断是否为 IP
+bool locate_ip_in_mpls(const uint8_t* data, size_t len, IpHeader& ip) {
+    for (int i = 0; i < MAX_MPLS_LABELS; ++i) {
+        if (len < MPLS_LABEL_LEN) {
+            return true;
+        }
+        bool bottom_of_stack = (data[2] & 0x01) != 0;
+        data += MPLS_LABEL_LEN;
+        len -= MPLS_LABEL_LEN;
+        if (bottom_of_stack) {
+            set_ip_header(data, len, ip);
+            return true;
+        }
+    }
+    // 标签栈过深，交给 pcpp
+    return false;
+}
+
+// data 指向以太类型字段之后的内容，先剥离 802.1Q / QinQ 标签
+bool locate_ip_by_ether_type(uint16_t ether_type,
+                             const uint8_t* data,
+                             size_t len,
+                             IpHeader& ip) {
+    for (int i = 0; i < MAX_VLAN_TAGS; ++i) {
+        if (ether_type != ETHERTYPE_VLAN && ether_type != ETHERTYPE_QINQ &&
+            ether_type != ETHERTYPE_QINQ_LEGACY) {
+            break;
+        }
+        if (len < VLAN_TAG_LEN) {
+            return true;
+        }
+        ether_type = load_be16(data + 2);
+        data += VLAN_TAG_LEN;
+        len -= VLAN_TAG_LEN;
+    }
+
+    switch (ether_type) {
+        case ETHERTYPE_IPV4:
+            set_ip_header(data, len, false, ip);
+            return true;
+        case ETHERTYPE_IPV6:
+            set_ip_header(data, len, true, ip);
+            return true;
+        case ETHERTYPE_MPLS_UNICAST:
+        case ETHERTYPE_MPLS_MULTICAST:
+            return locate_ip_in_mpls(data, len, ip);
+        case ETHERTYPE_ARP:
+            return true;
+        default:
+            // 802.3 帧没有网络层；PPPoE 等其余封装以及过多的 VLAN 标签交给
+            // pcpp
+            return ether_type < ETHERTYPE_MIN;
+    }
+}
+
+// 按链路层类型跳到网络层
+// 返回 false 表示快速路径无法处理，需要回退到 pcpp；
+// 返回 true 且 ip.data 为 nullptr 表示该包不含 IP
+bool locate_ip(const uint8_t* data,
+               size_t len,
+               pcpp::LinkLayerType link_type,
+               IpHeader& ip) {
+    ip = IpHeader();
+
+    switch (link_type) {
+        case pcpp::LINKTYPE_ETHERNET:
+            if (len < ETH_HEADER_LEN) {
+                return true;
+            }
+            return locate_ip_by_ether_type(load_be16(data + 12),
+                                           data + ETH_HEADER_LEN,
+                                           len - ETH_HEADER_LEN, ip);
+        case pcpp::LINKTYPE_LINUX_SLL:
+            if (len < SLL_HEADER_LEN) {
+                return true;
+            }
+            return locate_ip_by_ether_type(
+                load_be16(data + SLL_PROTOCOL_OFFSET), data + SLL_HEADER_LEN,
+                len - SLL_HEADER_LEN, ip);
+        case pcpp::LINKTYPE_LINUX_SLL2:
+            if (len < SLL2_HEADER_LEN) {
+                return true;
+            }
+            return locate_ip_by_ether_type(
+                load_be16(data + SLL2_PROTOCOL_OFFSET), data + SLL2_HEADER_LEN,
+                len - SLL2_HEADER_LEN, ip);
+        case pcpp::LINKTYPE_RAW:
+        case pcpp::LINKTYPE_DLT_RAW1:
+        case pcpp::LINKTYPE_DLT_RAW2:
+            // 没有链路层头，按版本号区分 IPv4 / IPv6
+            set_ip_header(data, len, ip);
+            return true;
+        case pcpp::LINKTYPE_IPV4:
+            set_ip_header(data, len, false, ip);
+            return true;
+        case pcpp::LINKTYPE_IPV6:
+            set_ip_header(data, len, true, ip);
+            return true;
+        case pcpp::LINKTYPE_NULL:
+        case pcpp::LINKTYPE_LOOP:
+            // 地址族字段的字节序取决于抓包主机，直接按版本号判断
+            if (len < NULL_HEADER_LEN) {
+                return true;
+            }
+            set_ip_header(data + NULL_HEADER_LEN, len - NULL_HEADER_LEN, ip);
+            return true;
+        default:
+            return false;
+    }
+}
+
+// pcpp 解析出的最外层 IP 层
+void locate_ip(const pcpp::Packet& packet, IpHeader& ip) {
+    ip = IpHeader();
+    for (pcpp::Layer* layer = packet.getFirstLayer(); layer != nullptr;
+         layer = layer->getNextLayer()) {
+        if (layer->getProtocol() == pcpp::IPv4 ||
+            layer->getProtocol() == pcpp::IPv6) {
+            set_ip_header(layer->getData(), layer->getDataLen(), ip);
+            return;
+        }
     }
 }
 
+inline uint32_t src_address(const IpHeader& ip) {
+    return ip.is_ipv6 ? fold_ipv6_address(ip.data + 8)
+                      : load_raw32(ip.data + 12);
+}
+
+inline uint32_t dst_address(const IpHeader& ip) {
+    return ip.is_ipv6 ? fold_ipv6_address(ip.data + 24)
+                      : load_raw32(ip.data + 16);
+}
+
+// 提取传输层协议号和端口，分片包与非 TCP/UDP 包端口为 0
+void load_transport(const IpHeader& ip,
+                    uint8_t& protocol,
+                    uint16_t& src_port,
+                    uint16_t& dst_port) {
+    src_port = 0;
+    dst_port = 0;
+
+    const uint8_t* hdr = ip.data;
+    size_t offset;
+    bool is_fragment;
+
+    if (!ip.is_ipv6) {
+        protocol = hdr[9];
+        // MF 标志或片偏移非零即为分片
+        is_fragment = (load_be16(hdr + 6) & 0x3FFF) != 0;
+        offset = static_cast<size_t>(hdr[0] & 0x0F) * 4;
+    } else {
+        // 跳过扩展头，找到上层协议
+        protocol = hdr[6];
+        is_fragment = false;
+        offset = IPV6_HEADER_LEN;
+        for (int i = 0; i < IPV6_MAX_EXTENSIONS; ++i) {
+            if (protocol != IPV6_EXT_HOP_BY_HOP &&
+                protocol != IPV6_EXT_ROUTING &&
+                protocol != IPV6_EXT_FRAGMENT && protocol != IPV6_EXT_AUTH &&
+                protocol != IPV6_EXT_DEST_OPTIONS) {
+                break;
+            }
+            if (ip.len < offset + 8) {
+                return;
+            }
+
+            uint8_t next = hdr[offset];
+            if (protocol == IPV6_EXT_FRAGMENT) {
+                is_fragment = true;
+                offset += 8;
+            } else if (protocol == IPV6_EXT_AUTH) {
+                offset += (static_cast<size_t>(hdr[offset + 1]) + 2) * 4;
+            } else {
+                offset += (static_cast<size_t>(hdr[offset + 1]) + 1) * 8;
+            }
+            protocol = next;
+        }
+    }
+
+    if (protocol != pcpp::PACKETPP_IPPROTO_TCP &&
+        protocol != pcpp::PACKETPP_IPPROTO_UDP) {
+        return;
+    }
+    if (is_fragment || ip.len < offset + 4) {
+        return;
+    }
+
+    src_port = load_be16(hdr + offset);
+    dst_port = load_be16(hdr + offset + 2);
+}
+
+// 由 IP 报头构造各类 FlowKey
+template <typename FlowKeyType>
+FlowKeyType build_flow(const IpHeader& ip);
+
 // OneTuple特化：只提取源IP
 template <>
-OneTuple PacketParser<OneTuple>::extract_flow(const pcpp::Packet& packet) {
-    auto* ipv4_layer = packet.getLayerOfType<pcpp::IPv4Layer>();
-    if (!ipv4_layer) {
-        return OneTuple();
-    }
-    return OneTuple(ipv4_layer->getSrcIPv4Address().toInt());
+OneTuple build_flow<OneTuple>(const IpHeader& ip) {
+    return OneTuple(src_address(ip));
 }
 
 // TwoTuple特化：提取源IP和目的IP
 template <>
-TwoTuple PacketParser<TwoTuple>::extract_flow(const pcpp::Packet& packet) {
-    auto* ipv4_layer = packet.getLayerOfType<pcpp::IPv4Layer>();
-    if (!ipv4_layer) {
-        return TwoTuple();
-    }
-    return TwoTuple(ipv4_layer->getSrcIPv4Address().toInt(),
-                    ipv4_layer->getDstIPv4Address().toInt());
+TwoTuple build_flow<TwoTuple>(const IpHeader& ip) {
+    return TwoTuple(src_address(ip), dst_address(ip));
 }
 
 // FiveTuple特化：提取源IP、目的IP、源端口、目的端口、协议
 template <>
-FiveTuple PacketParser<FiveTuple>::extract_flow(const pcpp::Packet& packet) {
-    auto* ipv4_layer = packet.getLayerOfType<pcpp::IPv4Layer>();
-    auto* tcp_layer = packet.getLayerOfType<pcpp::TcpLayer>();
-    auto* udp_layer = packet.getLayerOfType<pcpp::UdpLayer>();
+FiveTuple build_flow<FiveTuple>(const IpHeader& ip) {
+    uint8_t protocol;
+    uint16_t src_port, dst_port;
+    load_transport(ip, protocol, src_port, dst_port);
+    return FiveTuple(src_address(ip), dst_address(ip), src_port, dst_port,
+                     protocol);
+}
+
+}  // namespace
+
+template <typename FlowKeyType, typename SFINAE>
+bool PacketParser<FlowKeyType, SFINAE>::extract_flow_fast(
+    const PacketView& view,
+    pcpp::LinkLayerType link_type,
+    FlowKeyType& flow,
+    bool& ipv6) {
+    IpHeader ip;
+    if (!locate_ip(view.data, view.caplen, link_type, ip)) {
+        return false;
+    }
+    ipv6 = ip.data && ip.is_ipv6;
+    flow = ip.data ? build_flow<FlowKeyType>(ip) : FlowKeyType();
+    return true;
+}
+
+template <typename FlowKeyType, typename SFINAE>
+FlowKeyType PacketParser<FlowKeyType, SFINAE>::extract_flow(
+    const pcpp::Packet& packet,
+    bool& ipv6) {
+    IpHeader ip;
+    locate_ip(packet, ip);
+    ipv6 = ip.data && ip.is_ipv6;
+    return ip.data ? build_flow<FlowKeyType>(ip) : FlowKeyType();
+}
+
+template <typename FlowKeyType, typename SFINAE>
+FlowKeyType PacketParser<FlowKeyType, SFINAE>::extract_flow(
+    const PacketView& view,
+    pcpp::LinkLayerType link_type,
+    bool& ipv6) {
+    FlowKeyType flow;
+    if (extract_flow_fast(view, link_type, flow, ipv6)) {
+        return flow;
+    }
+
+    // 快速路径不认识的封装交给 pcpp 解析到网络层，只用来定位 IP 头；
+    // 协议号和端口随后由 load_transport 从 IP 头之后的原始字节读取，
+    // 不依赖 pcpp 的传输层解析
+    // RawPacket 只引用视图中的数据，不做拷贝也不负责释放
+    timespec ts = {};
+    pcpp::RawPacket raw_packet(view.data, static_cast<int>(view.caplen), ts,
+                               false, link_type);
+    pcpp::Packet parsed_packet(&raw_packet, pcpp::OsiModelNetworkLayer);
+    return extract_flow(parsed_packet, ipv6);
+}
+
+template <typename FlowKeyType, typename SFINAE>
+void PacketParser<FlowKeyType, SFINAE>::sort_by_timestamp(
+    PacketVector& packets,
+    bool is_sorted) {
+    // 解析时已确认有序，直接跳过
+    if (is_sorted) {
+        return;
+    }
+
+    // 抓包文件通常只在微秒级范围内乱序，插入排序此时接近线性；
+    // 移动次数超出预算说明乱序范围较大，转为归并排序
+    size_t budget = packets.size() * INSERTION_SORT_BUDGET;
+    size_t moves = 0;
+    for (size_t i = 1; i < packets.size(); ++i) {
+        if (!(packets[i].timestamp < packets[i - 1].timestamp)) {
+            continue;
+        }
+
+        PacketRecordType record = packets[i];
+        size_t j = i;
+        while (j > 0 && record.timestamp < packets[j - 1].timestamp &&
+               moves < budget) {
+            packets[j] = packets[j - 1];
+            --j;
+            ++moves;
+        }
+        packets[j] = record;
 
-    if (!ipv4_layer) {
-        return FiveTuple();
+        if (moves >= budget) {
+            break;
+        }
     }
 
-    uint8_t protocol = ipv4_layer->getProtocol();
-    uint16_t src_port = 0, dst_port = 0;
+    if (moves >= budget) {
+        std::stable_sort(
+            packets.begin(), packets.end(),
+            [](const PacketRecordType& a, const PacketRecordType& b) {
+                return a.timestamp < b.timestamp;
+            });
+    }
+}
 
-    if (protocol == pcpp::PACKETPP_IPPROTO_TCP && tcp_layer) {
-        src_port = tcp_layer->getSrcPort();
-        dst_port = tcp_layer->getDstPort();
-    } else if (protocol == pcpp::PACKETPP_IPPROTO_UDP && udp_layer) {
-        src_port = udp_layer->getSrcPort();
-        dst_port = udp_layer->getDstPort();
+template <typename FlowKeyType, typename SFINAE>
+void PacketParser<FlowKeyType, SFINAE>::sort_by_timestamp(
+    ColumnsType& columns,
+    bool is_sorted) {
+    if (!is_sorted) {
+        columns.sort_by_timestamp();
     }
+}
+
+template <typename FlowKeyType, typename SFINAE>
+void PacketParser<FlowKeyType, SFINAE>::append_record(PacketVector& packets,
+                                                      const FlowKeyType& flow,
+                                                      const PacketView& view) {
+    PacketRecordType record;
+    record.flow = flow;
+    record.timestamp = view.timestamp;
+    record.length = view.len;
+    packets.push_back(record);
+}
+
+template <typename FlowKeyType, typename SFINAE>
+void PacketParser<FlowKeyType, SFINAE>::append_record(ColumnsType& columns,
+                                                      const FlowKeyType& flow,
+                                                      const PacketView& view) {
+    columns.push_back(flow, view.timestamp, view.len);
+}
+
+template <typename FlowKeyType, typename SFINAE>
+void PacketParser<FlowKeyType, SFINAE>::append_all(PacketVector& packets,
+                                                   PacketVector& chunk) {
+    packets.insert(packets.end(), chunk.begin(), chunk.end());
+    PacketVector().swap(chunk);
+}
 
-    return FiveTuple(ipv4_layer->getSrcIPv4Address().toInt(),
-                     ipv4_layer->getDstIPv4Address().toInt(), src_port,
-                     dst_port, protocol);
+template <typename FlowKeyType, typename SFINAE>
+void PacketParser<FlowKeyType, SFINAE>::append_all(ColumnsType& columns,
+                                                   ColumnsType& chunk) {
+    columns.append(std::move(chunk));
 }
 
 template <typename FlowKeyType, typename SFINAE>
@@ -246,91 +1104,269 @@ PacketParser<FlowKeyType, SFINAE>::parse_pcap(
     const std::string& file_path) const {
     PacketVector packets;
 
-    PcapReader reader(file_path);
+    if (use_cache_) {
+        RecordCache<FlowKeyType> cache(cache_dir_);
+        if (cache.load(file_path, packets, ipv6_records_)) {
+            return packets;
+        }
+        parse_into(file_path, packets, ipv6_records_);
+        cache.store(file_path, packets, ipv6_records_);
+        return packets;
+    }
+
+    parse_into(file_path, packets, ipv6_records_);
+    return packets;
+}
+
+template <typename FlowKeyType, typename SFINAE>
+typename PacketParser<FlowKeyType, SFINAE>::ColumnsType
+PacketParser<FlowKeyType, SFINAE>::parse_pcap_columns(
+    const std::string& file_path,
+    bool with_lengths) const {
+    ColumnsType columns(with_lengths);
+
+    // 缓存按记录格式存储：经由 parse_pcap 命中或写入缓存后再转为列，
+    // 转换期间记录与列同时占用内存
+    if (use_cache_) {
+        PacketVector packets = parse_pcap(file_path);
+        columns.reserve(packets.size());
+        for (const PacketRecordType& record : packets) {
+            columns.push_back(record.flow, record.timestamp, record.length);
+        }
+        return columns;
+    }
+
+    parse_into(file_path, columns, ipv6_records_);
+    return columns;
+}
+
+template <typename FlowKeyType, typename SFINAE>
+template <typename Container>
+void PacketParser<FlowKeyType, SFINAE>::parse_into(
+    const std::string& file_path,
+    Container& out,
+    uint64_t& ipv6_records) const {
+    PcapReader reader(file_path, true);
     if (!reader.open()) {
         throw std::runtime_error("Failed to open pcap file: " + file_path);
     }
 
-    packets.reserve(estimate_packet_count(file_path));
+    size_t estimated_packets = estimate_packet_count(file_path);
+    size_t num_threads =
+        num_threads_ > 0 ? num_threads_
+                         : std::max(1u, std::thread::hardware_concurrency());
 
-    pcpp::RawPacket raw_packet;
-    while (reader.get_next_packet(raw_packet)) {
-        pcpp::Packet parsed_packet(&raw_packet, pcpp::OsiModelNetworkLayer);
+    bool is_sorted = true;
+    ipv6_records = 0;
+    if (num_threads > 1 && reader.is_mapped()) {
+        parse_parallel(reader, num_threads, estimated_packets, out, is_sorted,
+                       ipv6_records);
+        reader.close();
+        sort_by_timestamp(out, is_sorted);
+        return;
+    }
+
+    out.reserve(estimated_packets);
 
+    auto last_timestamp = std::chrono::nanoseconds::min();
+    PacketView view;
+    while (reader.get_next_packet(view)) {
         // 提取FlowKey
-        FlowKeyType flow = extract_flow(parsed_packet);
+        bool ipv6;
+        FlowKeyType flow = extract_flow(view, view.link_type, ipv6);
 
         // 检查是否为有效流
         if (flow == FlowKeyType()) {
             continue;
         }
+        ipv6_records += ipv6;
 
-        PacketRecordType record;
-        record.flow = flow;
-
-        const timespec& ts = raw_packet.getPacketTimeStamp();
-        record.timestamp = std::chrono::seconds{ts.tv_sec} +
-                           std::chrono::nanoseconds{ts.tv_nsec};
+        if (view.timestamp < last_timestamp) {
+            is_sorted = false;
+        }
+        last_timestamp = view.timestamp;
 
-        packets.push_back(record);
+        append_record(out, flow, view);
     }
 
     reader.close();
 
     // 按时间戳排序
-    std::sort(packets.begin(), packets.end(),
-              [](const PacketRecordType& a, const PacketRecordType& b) {
-                  return a.timestamp < b.timestamp;
-              });
+    sort_by_timestamp(out, is_sorted);
+}
 
-    return packets;
+template <typename FlowKeyType, typename SFINAE>
+template <typename Container>
+void PacketParser<FlowKeyType, SFINAE>::parse_parallel(
+    const PcapReader& reader,
+    size_t num_threads,
+    size_t estimated_packets,
+    Container& out,
+    bool& is_sorted,
+    uint64_t& ipv6_records) const {
+    // 切得比线程数更细，由线程按序领取，平衡各块解析耗时差异
+    std::vector<size_t> boundaries = reader.split_chunks(num_threads * 4);
+    size_t chunk_count = boundaries.size() - 1;
+    size_t total_bytes = boundaries.back() - boundaries.front();
+
+    using Timestamp = std::chrono::nanoseconds;
+
+    // 各块记录的容器与 out 配置相同
+    std::vector<Container> chunks(chunk_count, out);
+    std::vector<char> chunk_sorted(chunk_count, 1);
+    std::vector<Timestamp> first_timestamps(chunk_count, Timestamp::max());
+    std::vector<Timestamp> last_timestamps(chunk_count, Timestamp::min());
+    std::vector<uint64_t> chunk_ipv6(chunk_count, 0);
+    std::vector<std::exception_ptr> errors(chunk_count);
+    std::atomic<size_t> next_chunk{0};
+
+    auto worker = [&]() {
+        size_t index;
+        while ((index = next_chunk.fetch_add(1)) < chunk_count) {
+            size_t begin = boundaries[index];
+            size_t end = boundaries[index + 1];
+            Container& local = chunks[index];
+            local.reserve(estimated_packets * (end - begin) /
+                          std::max<size_t>(total_bytes, 1));
+
+            try {
+                PacketView view;
+                while (reader.get_packet_at(begin, end, view)) {
+                    bool ipv6;
+                    FlowKeyType flow = extract_flow(view, view.link_type, ipv6);
+                    if (flow == FlowKeyType()) {
+                        continue;
+                    }
+                    chunk_ipv6[index] += ipv6;
+
+                    if (view.timestamp < last_timestamps[index]) {
+                        chunk_sorted[index] = 0;
+                    }
+                    if (first_timestamps[index] == Timestamp::max()) {
+                        first_timestamps[index] = view.timestamp;
+                    }
+                    last_timestamps[index] = view.timestamp;
+
+                    append_record(local, flow, view);
+                }
+            } catch (...) {
+                errors[index] = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    size_t thread_count = std::min(num_threads, chunk_count);
+    threads.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads.emplace_back(worker);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // 按文件顺序重新抛出第一个错误，与串行路径的行为一致
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    // 按块的文件顺序拼接，排序前的序列与串行解析完全相同
+    size_t total = 0;
+    for (const auto& chunk : chunks) {
+        total += chunk.size();
+    }
+    out.reserve(total);
+
+    // 各块内部有序且块与块衔接处有序时，整体有序
+    Timestamp last_timestamp = Timestamp::min();
+    for (size_t i = 0; i < chunk_count; ++i) {
+        if (chunks[i].empty()) {
+            continue;
+        }
+        if (!chunk_sorted[i] || first_timestamps[i] < last_timestamp) {
+            is_sorted = false;
+        }
+        last_timestamp = last_timestamps[i];
+        ipv6_records += chunk_ipv6[i];
+        append_all(out, chunks[i]);
+    }
 }
 
 template <typename FlowKeyType, typename SFINAE>
-std::vector<typename PacketParser<FlowKeyType, SFINAE>::PacketVector>
+PacketParser<FlowKeyType, SFINAE>::Stream::Stream(const std::string& file_path,
+                                                  size_t batch_size)
+    : reader_(new PcapReader(file_path, true)),
+      batch_size_(std::max<size_t>(batch_size, 1)),
+      ipv6_records_(0) {
+    if (!reader_->open()) {
+        throw std::runtime_error("Failed to open pcap file: " + file_path);
+    }
+}
+
+template <typename FlowKeyType, typename SFINAE>
+bool PacketParser<FlowKeyType, SFINAE>::Stream::next_batch(
+    PacketVector& batch) {
+    batch.clear();
+    batch.reserve(batch_size_);
+
+    PacketView view;
+    while (batch.size() < batch_size_ && reader_->get_next_packet(view)) {
+        bool ipv6;
+        FlowKeyType flow = extract_flow(view, view.link_type, ipv6);
+        if (flow == FlowKeyType()) {
+            continue;
+        }
+        ipv6_records_ += ipv6;
+
+        append_record(batch, flow, view);
+    }
+
+    reader_->release_consumed();
+    return !batch.empty();
+}
+
+template <typename FlowKeyType, typename SFINAE>
+typename PacketParser<FlowKeyType, SFINAE>::EpochVector
 PacketParser<FlowKeyType, SFINAE>::parse_pcap_with_epochs(
     const std::string& file_path, std::chrono::nanoseconds epoch) const {
+    return split_epochs(parse_pcap(file_path), epoch);
+}
 
-    PacketVector packets = parse_pcap(file_path);
+template <typename FlowKeyType, typename SFINAE>
+typename PacketParser<FlowKeyType, SFINAE>::EpochVector
+PacketParser<FlowKeyType, SFINAE>::split_epochs(
+    PacketVector packets, std::chrono::nanoseconds epoch) {
+    std::vector<size_t> bounds;
+    bounds.push_back(0);
 
     // epoch 为 0 ，不切分
     if (epoch == std::chrono::nanoseconds{0}) {
-        std::vector<PacketVector> result;
-        result.push_back(packets);
-        return result;
+        bounds.push_back(packets.size());
+        return EpochVector(std::move(packets), std::move(bounds));
     }
 
-    // 按 epoch 切分
-    std::vector<PacketVector> result;
     if (packets.empty()) {
-        return result;
+        return EpochVector();
     }
 
+    // 每个 epoch 的结束位置用二分查找定位，空窗口直接跳过
     auto start_time = packets.front().timestamp;
-    result.emplace_back();
-    auto current_epoch_start = start_time;
-
-    // 遍历所有数据包，按时间窗口分组
-    for (const auto& packet : packets) {
-        auto offset = packet.timestamp - current_epoch_start;
+    auto begin = packets.begin();
+    while (begin != packets.end()) {
+        auto index = (begin->timestamp - start_time) / epoch;
+        auto epoch_end = start_time + (index + 1) * epoch;
 
-        // 新 epoch
-        while (offset >= epoch) {
-            current_epoch_start += epoch;
-            result.emplace_back();
-            offset = packet.timestamp - current_epoch_start;
-        }
-
-        result.back().push_back(packet);
+        begin = std::lower_bound(
+            begin, packets.end(), epoch_end,
+            [](const PacketRecordType& record, std::chrono::nanoseconds ts) {
+                return record.timestamp < ts;
+            });
+        bounds.push_back(static_cast<size_t>(begin - packets.begin()));
     }
 
-    // 移除空的epoch窗口
-    result.erase(
-        std::remove_if(result.begin(), result.end(),
-                      [](const PacketVector& pv) { return pv.empty(); }),
-        result.end());
-
-    return result;
+    return EpochVector(std::move(packets), std::move(bounds));
 }
 
 // 显式实例化
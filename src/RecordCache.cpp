@@ -0,0 +1,255 @@
+#include "RecordCache.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <type_traits>
+
+namespace {
+
+constexpr char CACHE_MAGIC[8] = {'M', 'D', 'V', 'H', 'R', 'E', 'C', '\0'};
+constexpr uint32_t CACHE_VERSION = 5;
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+constexpr size_t RECORDS_OFFSET = 64;
+// 写入时每次经过暂存区的记录数
+constexpr size_t STORE_CHUNK_RECORDS = 4096;
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t key_type;
+    uint32_t record_size;
+    uint32_t extractor_version;  // PacketParser::EXTRACTOR_VERSION
+    uint64_t record_count;
+    uint64_t source_size;
+    int64_t source_mtime_ns;
+    uint64_t ipv6_records;  // 地址由 IPv6 折叠而来的记录数
+};
+
+static_assert(sizeof(CacheHeader) <= RECORDS_OFFSET,
+              "Cache header must fit before the record area");
+
+// 各 FlowKey 类型的缓存标识
+template <typename FlowKeyType>
+struct FlowKeyTag;
+
+template <>
+struct FlowKeyTag<OneTuple> {
+    static constexpr uint32_t id = 1;
+    static const char* name() { return "one"; }
+};
+
+template <>
+struct FlowKeyTag<TwoTuple> {
+    static constexpr uint32_t id = 2;
+    static const char* name() { return "two"; }
+};
+
+template <>
+struct FlowKeyTag<FiveTuple> {
+    static constexpr uint32_t id = 5;
+    static const char* name() { return "five"; }
+};
+
+bool stat_source(const std::string& path, uint64_t& size, int64_t& mtime_ns) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    size = static_cast<uint64_t>(st.st_size);
+    mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 +
+               st.st_mtim.tv_nsec;
+    return true;
+}
+
+// 缓存文件名中的路径指纹，区分不同目录下的同名 pcap
+uint64_t path_hash(const std::string& path) {
+    uint64_t hash = 14695981039346656037ull;  // FNV-1a
+    for (unsigned char c : path) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool write_all(int fd, const void* data, size_t size) {
+    const char* ptr = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = ::write(fd, ptr, size);
+        if (written <= 0) {
+            return false;
+        }
+        ptr += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool read_all(int fd, void* data, size_t size) {
+    char* ptr = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t n = ::read(fd, ptr, size);
+        if (n <= 0) {
+            return false;
+        }
+        ptr += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+}  // namespace
+
+template <typename FlowKeyType, typename SFINAE>
+RecordCache<FlowKeyType, SFINAE>::RecordCache(const std::string& cache_dir)
+    : cache_dir_(cache_dir) {}
+
+template <typename FlowKeyType, typename SFINAE>
+std::string RecordCache<FlowKeyType, SFINAE>::cache_path(
+    const std::string& pcap_path) const {
+    std::string base = pcap_path;
+    if (!cache_dir_.empty()) {
+        size_t slash = pcap_path.find_last_of('/');
+        std::string file_name = slash == std::string::npos
+                                    ? pcap_path
+                                    : pcap_path.substr(slash + 1);
+        // 共享目录中按源文件的绝对路径区分同名文件，无法解析时用原路径
+        char resolved[PATH_MAX];
+        std::string source = realpath(pcap_path.c_str(), resolved) != nullptr
+                                 ? std::string(resolved)
+                                 : pcap_path;
+        char hash[17];
+        std::snprintf(hash, sizeof(hash), "%016llx",
+                      static_cast<unsigned long long>(path_hash(source)));
+        base = cache_dir_ + "/" + file_name + "." + hash;
+    }
+    return base + "." + FlowKeyTag<FlowKeyType>::name() + ".mdvcache";
+}
+
+template <typename FlowKeyType, typename SFINAE>
+bool RecordCache<FlowKeyType, SFINAE>::load(const std::string& pcap_path,
+                                            PacketVector& packets,
+                                            uint64_t& ipv6_records) const {
+    uint64_t source_size;
+    int64_t source_mtime_ns;
+    if (!stat_source(pcap_path, source_size, source_mtime_ns)) {
+        return false;
+    }
+
+    std::string path = cache_path(pcap_path);
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    CacheHeader header;
+    uint8_t prefix[RECORDS_OFFSET];
+    if (fstat(fd, &st) != 0 ||
+        static_cast<size_t>(st.st_size) < RECORDS_OFFSET ||
+        !read_all(fd, prefix, sizeof(prefix))) {
+        ::close(fd);
+        return false;
+    }
+    std::memcpy(&header, prefix, sizeof(header));
+
+    size_t records_size = static_cast<size_t>(st.st_size) - RECORDS_OFFSET;
+    bool valid =
+        std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 &&
+        header.version == CACHE_VERSION &&
+        header.byte_order == BYTE_ORDER_MARK &&
+        header.key_type == FlowKeyTag<FlowKeyType>::id &&
+        header.record_size == sizeof(PacketRecordType) &&
+        header.extractor_version ==
+            PacketParser<FlowKeyType>::EXTRACTOR_VERSION &&
+        header.source_size == source_size &&
+        header.source_mtime_ns == source_mtime_ns &&
+        header.record_count == records_size / sizeof(PacketRecordType) &&
+        records_size % sizeof(PacketRecordType) == 0;
+
+    if (valid) {
+        // 记录区直接读入目标数组，只经过一次拷贝
+        posix_fadvise(fd, RECORDS_OFFSET, 0, POSIX_FADV_SEQUENTIAL);
+        packets.resize(header.record_count);
+        valid = read_all(fd, packets.data(), records_size);
+        if (!valid) {
+            packets.clear();
+        }
+        ipv6_records = header.ipv6_records;
+    }
+
+    ::close(fd);
+    return valid;
+}
+
+template <typename FlowKeyType, typename SFINAE>
+bool RecordCache<FlowKeyType, SFINAE>::store(
+    const std::string& pcap_path,
+    const PacketVector& packets,
+    uint64_t ipv6_records) const {
+    static_assert(std::is_trivially_copyable<PacketRecordType>::value,
+                  "PacketRecord must be trivially copyable to be cached");
+
+    CacheHeader header = {};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.key_type = FlowKeyTag<FlowKeyType>::id;
+    header.record_size = sizeof(PacketRecordType);
+    header.extractor_version = PacketParser<FlowKeyType>::EXTRACTOR_VERSION;
+    header.record_count = packets.size();
+    header.ipv6_records = ipv6_records;
+    if (!stat_source(pcap_path, header.source_size, header.source_mtime_ns)) {
+        return false;
+    }
+
+    std::string path = cache_path(pcap_path);
+    std::string tmp_path = path + ".tmp." + std::to_string(getpid());
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    uint8_t prefix[RECORDS_OFFSET] = {};
+    std::memcpy(prefix, &header, sizeof(header));
+
+    // 记录逐字段拷入清零的暂存区再写出，结构体中的填充字节写为 0，
+    // 不把未初始化的内存带进缓存文件
+    std::vector<uint8_t> chunk(STORE_CHUNK_RECORDS * sizeof(PacketRecordType));
+    bool ok = write_all(fd, prefix, sizeof(prefix));
+    for (size_t base = 0; ok && base < packets.size();
+         base += STORE_CHUNK_RECORDS) {
+        size_t count = std::min(STORE_CHUNK_RECORDS, packets.size() - base);
+        std::memset(chunk.data(), 0, count * sizeof(PacketRecordType));
+        for (size_t i = 0; i < count; ++i) {
+            const PacketRecordType& record = packets[base + i];
+            uint8_t* out = chunk.data() + i * sizeof(PacketRecordType);
+            std::memcpy(out + offsetof(PacketRecordType, flow), &record.flow,
+                        sizeof(record.flow));
+            std::memcpy(out + offsetof(PacketRecordType, length),
+                        &record.length, sizeof(record.length));
+            std::memcpy(out + offsetof(PacketRecordType, timestamp),
+                        &record.timestamp, sizeof(record.timestamp));
+        }
+        ok = write_all(fd, chunk.data(), count * sizeof(PacketRecordType));
+    }
+    ok = ::close(fd) == 0 && ok;
+
+    if (!ok || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+// 显式实例化
+template class RecordCache<OneTuple>;
+template class RecordCache<TwoTuple>;
+template class RecordCache<FiveTuple>;
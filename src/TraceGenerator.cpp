@@ -0,0 +1,421 @@
+#include "TraceGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr uint32_t PCAP_MAGIC_NANOSECONDS = 0xa1b23c4d;
+constexpr uint32_t LINKTYPE_ETHERNET = 1;
+constexpr size_t PCAP_RECORD_HEADER_LENGTH = 16;
+constexpr size_t WRITE_BUFFER_SIZE = 1 << 20;
+
+constexpr size_t ETHERNET_HEADER_LENGTH = 14;
+constexpr size_t IPV4_HEADER_LENGTH = 20;
+constexpr size_t IPV6_HEADER_LENGTH = 40;
+constexpr size_t TCP_HEADER_LENGTH = 20;
+constexpr size_t UDP_HEADER_LENGTH = 8;
+
+// 除 0 与 240.0.0.0/4 以外的 IPv4 源地址数，即互不相同的 IPv4 流数上限
+constexpr uint32_t MAX_IPV4_SOURCES = FOLDED_IPV6_PREFIX - 1;
+
+constexpr uint8_t PROTOCOL_TCP = 6;
+constexpr uint8_t PROTOCOL_UDP = 17;
+
+// 流表与包序列使用相互独立的随机数序列，reset 不影响已生成的流
+constexpr uint64_t FLOW_STREAM = 0x5f3759df9e3779b9ULL;
+constexpr uint64_t PACKET_STREAM = 0x2545f4914f6cdd1dULL;
+
+// SplitMix64，不依赖标准库分布的实现，随机数序列跨平台一致
+inline uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+inline double to_unit(uint64_t value) {
+    return static_cast<double>(value >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// murmur3 的 fmix32，是 32 位整数上的双射：输入互不相同则输出互不相同
+inline uint32_t mix32(uint32_t value) {
+    value ^= value >> 16;
+    value *= 0x85ebca6bu;
+    value ^= value >> 13;
+    value *= 0xc2b2ae35u;
+    value ^= value >> 16;
+    return value;
+}
+
+// pcap 文件头与记录头固定按小端写出，与生成机器的字节序无关
+inline void append_le16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back(static_cast<uint8_t>(value));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+inline void append_le32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(static_cast<uint8_t>(value >> shift));
+    }
+}
+
+inline void store_be16(uint8_t* dst, uint16_t value) {
+    dst[0] = static_cast<uint8_t>(value >> 8);
+    dst[1] = static_cast<uint8_t>(value);
+}
+
+inline void store_be32(uint8_t* dst, uint32_t value) {
+    dst[0] = static_cast<uint8_t>(value >> 24);
+    dst[1] = static_cast<uint8_t>(value >> 16);
+    dst[2] = static_cast<uint8_t>(value >> 8);
+    dst[3] = static_cast<uint8_t>(value);
+}
+
+// IPv6 流使用文档前缀 2001:db8::/32，低 32 位区分不同主机
+inline void store_ipv6_address(uint8_t* dst, uint32_t low_bits) {
+    static const uint8_t PREFIX[12] = {0x20, 0x01, 0x0d, 0xb8, 0, 0,
+                                       0,    0,    0,    0,    0, 0};
+    std::memcpy(dst, PREFIX, sizeof(PREFIX));
+    store_be32(dst + sizeof(PREFIX), low_bits);
+}
+
+inline size_t header_length(bool ipv6, uint8_t protocol) {
+    return ETHERNET_HEADER_LENGTH +
+           (ipv6 ? IPV6_HEADER_LENGTH : IPV4_HEADER_LENGTH) +
+           (protocol == PROTOCOL_TCP ? TCP_HEADER_LENGTH : UDP_HEADER_LENGTH);
+}
+
+inline bool is_ratio(double value) {
+    return value >= 0.0 && value <= 1.0;
+}
+
+void validate(const TraceConfig& config) {
+    if (config.flow_count == 0) {
+        throw std::runtime_error("流数量必须大于 0");
+    }
+    if (config.flow_count > MAX_IPV4_SOURCES) {
+        throw std::runtime_error("流数量超过可用的 IPv4 源地址数");
+    }
+    if (config.distribution == FlowSizeDistribution::ZIPF &&
+        !(config.zipf_alpha >= 0.0)) {
+        throw std::runtime_error("Zipf 指数不能为负");
+    }
+    if (config.distribution == FlowSizeDistribution::PARETO &&
+        !(config.pareto_shape > 0.0)) {
+        throw std::runtime_error("Pareto 形状参数必须大于 0");
+    }
+    if (!is_ratio(config.ipv6_ratio) || !is_ratio(config.udp_ratio)) {
+        throw std::runtime_error("IPv6 与 UDP 比例必须在 [0, 1] 内");
+    }
+    if (config.min_frame_length > config.max_frame_length) {
+        throw std::runtime_error("最小帧长度大于最大帧长度");
+    }
+    if (config.snap_length == 0) {
+        throw std::runtime_error("截断长度必须大于 0");
+    }
+    if (config.packets_per_second == 0) {
+        throw std::runtime_error("包速率必须大于 0");
+    }
+}
+
+}  // namespace
+
+TraceGenerator::TraceGenerator(const TraceConfig& config)
+    : config_(config),
+      rng_state_(0),
+      emitted_(0),
+      clock_(config.start_time),
+      max_gap_ns_(0),
+      frame_(std::max<size_t>(config.max_frame_length,
+                              size_t{MAX_HEADER_LENGTH}),
+             0) {
+    validate(config_);
+    max_gap_ns_ = 2 * (1000000000ULL / config_.packets_per_second);
+    build_flows();
+    reset();
+}
+
+void TraceGenerator::reset() {
+    rng_state_ = config_.seed ^ PACKET_STREAM;
+    emitted_ = 0;
+    clock_ = config_.start_time;
+}
+
+void TraceGenerator::build_flows() {
+    uint64_t state = config_.seed ^ FLOW_STREAM;
+    uint32_t length_span = static_cast<uint32_t>(config_.max_frame_length) -
+                           config_.min_frame_length + 1;
+
+    // IPv4 源地址为 mix32(序号 ^ 密钥)：取遍 32 位且互不相同，
+    // OneTuple 下每条候选流对应一个独立的 key；跳过 0（parse_pcap 会把该流
+    // 当作无效流丢弃）与 IPv6 折叠地址所在的 240.0.0.0/4
+    uint32_t source_key = static_cast<uint32_t>(splitmix64(state));
+    uint64_t source_index = 0;
+    auto next_source = [&]() {
+        uint32_t addr;
+        do {
+            addr = mix32(static_cast<uint32_t>(source_index++) ^ source_key);
+        } while (addr == 0 ||
+                 (addr & FOLDED_IPV6_PREFIX) == FOLDED_IPV6_PREFIX);
+        return addr;
+    };
+
+    flows_.resize(config_.flow_count);
+    for (FlowSpec& flow : flows_) {
+        uint64_t addresses = splitmix64(state);
+        uint64_t ports = splitmix64(state);
+        uint64_t shape = splitmix64(state);
+
+        flow.ipv6 = to_unit(splitmix64(state)) < config_.ipv6_ratio;
+        flow.protocol = to_unit(splitmix64(state)) < config_.udp_ratio
+                            ? PROTOCOL_UDP
+                            : PROTOCOL_TCP;
+        if (flow.ipv6) {
+            flow.src_addr = static_cast<uint32_t>(addresses >> 32);
+            flow.dst_addr = static_cast<uint32_t>(addresses);
+        } else {
+            // 目的地址取自 172.16.0.0/12
+            flow.src_addr = next_source();
+            flow.dst_addr =
+                0xac100000u | (static_cast<uint32_t>(addresses) & 0xfffffu);
+        }
+        // 源端口为临时端口，目的端口取自 1-1023 的知名端口
+        flow.src_port = static_cast<uint16_t>(
+            49152 + static_cast<uint32_t>(ports >> 32) % 16384);
+        flow.dst_port =
+            static_cast<uint16_t>(1 + static_cast<uint32_t>(ports) % 1023);
+
+        size_t frame_length = config_.min_frame_length + shape % length_span;
+        flow.frame_length = static_cast<uint16_t>(
+            std::max(frame_length, header_length(flow.ipv6, flow.protocol)));
+    }
+
+    std::vector<double> weights(config_.flow_count);
+    if (config_.distribution == FlowSizeDistribution::ZIPF) {
+        for (size_t i = 0; i < weights.size(); ++i) {
+            weights[i] = std::pow(static_cast<double>(i + 1),
+                                  -config_.zipf_alpha);
+        }
+    } else {
+        // 逆变换抽样：x = u^(-1/shape)，u 取 (0, 1]
+        for (double& weight : weights) {
+            double u = 1.0 - to_unit(splitmix64(state));
+            weight = std::pow(u, -1.0 / config_.pareto_shape);
+        }
+    }
+    build_alias_table(weights);
+}
+
+void TraceGenerator::build_alias_table(const std::vector<double>& weights) {
+    size_t n = weights.size();
+    double total = 0.0;
+    for (double weight : weights) {
+        total += weight;
+    }
+
+    alias_prob_.resize(n);
+    alias_.resize(n);
+    std::vector<uint32_t> small;
+    std::vector<uint32_t> large;
+    for (size_t i = 0; i < n; ++i) {
+        alias_prob_[i] = weights[i] * n / total;
+        alias_[i] = static_cast<uint32_t>(i);
+        (alias_prob_[i] < 1.0 ? small : large)
+            .push_back(static_cast<uint32_t>(i));
+    }
+
+    // Vose 算法：每次用一个不足 1 的列配一个超过 1 的列补齐
+    while (!small.empty() && !large.empty()) {
+        uint32_t less = small.back();
+        small.pop_back();
+        uint32_t more = large.back();
+        alias_[less] = more;
+        alias_prob_[more] -= 1.0 - alias_prob_[less];
+        if (alias_prob_[more] < 1.0) {
+            large.pop_back();
+            small.push_back(more);
+        }
+    }
+    // 剩余的列只受浮点舍入影响，概率取 1
+    for (uint32_t i : small) {
+        alias_prob_[i] = 1.0;
+    }
+    for (uint32_t i : large) {
+        alias_prob_[i] = 1.0;
+    }
+}
+
+uint64_t TraceGenerator::next_random() {
+    return splitmix64(rng_state_);
+}
+
+double TraceGenerator::next_unit() {
+    return to_unit(next_random());
+}
+
+const TraceGenerator::FlowSpec& TraceGenerator::draw_packet(
+    std::chrono::nanoseconds& timestamp) {
+    uint64_t column_bits = next_random();
+    size_t column = static_cast<size_t>(
+        ((column_bits >> 32) * static_cast<uint64_t>(flows_.size())) >> 32);
+    size_t index = next_unit() < alias_prob_[column] ? column : alias_[column];
+
+    timestamp = clock_;
+    clock_ += std::chrono::nanoseconds{
+        static_cast<int64_t>(next_random() % (max_gap_ns_ + 1))};
+    ++emitted_;
+    return flows_[index];
+}
+
+size_t TraceGenerator::build_frame(const FlowSpec& flow) {
+    uint8_t* frame = frame_.data();
+    std::memset(frame, 0, MAX_HEADER_LENGTH);
+
+    // 以太网头部：本地管理的 MAC 地址
+    frame[0] = 0x02;
+    frame[5] = 0x01;
+    frame[6] = 0x02;
+    frame[11] = 0x02;
+    store_be16(frame + 12, flow.ipv6 ? 0x86dd : 0x0800);
+
+    uint8_t* ip = frame + ETHERNET_HEADER_LENGTH;
+    size_t ip_length = flow.frame_length - ETHERNET_HEADER_LENGTH;
+    uint8_t* l4;
+    if (flow.ipv6) {
+        ip[0] = 0x60;
+        store_be16(ip + 4,
+                   static_cast<uint16_t>(ip_length - IPV6_HEADER_LENGTH));
+        ip[6] = flow.protocol;
+        ip[7] = 64;
+        store_ipv6_address(ip + 8, flow.src_addr);
+        store_ipv6_address(ip + 24, flow.dst_addr);
+        l4 = ip + IPV6_HEADER_LENGTH;
+    } else {
+        ip[0] = 0x45;
+        store_be16(ip + 2, static_cast<uint16_t>(ip_length));
+        ip[6] = 0x40;  // DF
+        ip[8] = 64;
+        ip[9] = flow.protocol;
+        store_be32(ip + 12, flow.src_addr);
+        store_be32(ip + 16, flow.dst_addr);
+        l4 = ip + IPV4_HEADER_LENGTH;
+    }
+
+    store_be16(l4, flow.src_port);
+    store_be16(l4 + 2, flow.dst_port);
+    if (flow.protocol == PROTOCOL_TCP) {
+        l4[12] = 0x50;  // 数据偏移 5
+        l4[13] = 0x10;  // ACK
+        store_be16(l4 + 14, 0xffff);
+    } else {
+        store_be16(l4 + 4,
+                   static_cast<uint16_t>(flow.frame_length - (l4 - frame)));
+    }
+    return std::min<size_t>(flow.frame_length, config_.snap_length);
+}
+
+bool TraceGenerator::next_packet(PacketView& view) {
+    if (emitted_ >= config_.packet_count) {
+        return false;
+    }
+    const FlowSpec& flow = draw_packet(view.timestamp);
+    view.caplen = static_cast<uint32_t>(build_frame(flow));
+    view.len = flow.frame_length;
+    view.data = frame_.data();
+    view.link_type = pcpp::LINKTYPE_ETHERNET;
+    return true;
+}
+
+void TraceGenerator::write_pcap(const std::string& path) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("无法创建文件: " + path);
+    }
+
+    std::vector<uint8_t> buffer;
+    buffer.reserve(WRITE_BUFFER_SIZE + PCAP_RECORD_HEADER_LENGTH +
+                   frame_.size());
+    auto append = [&buffer](const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        buffer.insert(buffer.end(), bytes, bytes + size);
+    };
+    auto drain = [&]() {
+        out.write(reinterpret_cast<const char*>(buffer.data()),
+                  static_cast<std::streamsize>(buffer.size()));
+        buffer.clear();
+        if (!out) {
+            throw std::runtime_error("写入文件失败: " + path);
+        }
+    };
+
+    // 文件头：魔数、版本 2.4、时区、时间精度、snaplen、链路层类型
+    append_le32(buffer, PCAP_MAGIC_NANOSECONDS);
+    append_le16(buffer, 2);
+    append_le16(buffer, 4);
+    append_le32(buffer, 0);
+    append_le32(buffer, 0);
+    append_le32(buffer, config_.snap_length);
+    append_le32(buffer, LINKTYPE_ETHERNET);
+
+    reset();
+    PacketView view;
+    while (next_packet(view)) {
+        uint64_t ns = static_cast<uint64_t>(view.timestamp.count());
+        append_le32(buffer, static_cast<uint32_t>(ns / 1000000000));
+        append_le32(buffer, static_cast<uint32_t>(ns % 1000000000));
+        append_le32(buffer, view.caplen);
+        append_le32(buffer, view.len);
+        append(view.data, view.caplen);
+        if (buffer.size() >= WRITE_BUFFER_SIZE) {
+            drain();
+        }
+    }
+    drain();
+
+    out.close();
+    if (!out) {
+        throw std::runtime_error("写入文件失败: " + path);
+    }
+}
+
+template <typename FlowKeyType>
+void TraceGenerator::generate_records(
+    std::vector<PacketRecord<FlowKeyType>>& records) {
+    // 每条流只解析一次头部，与从文件解析走同一条提取路径
+    std::vector<FlowKeyType> keys(flows_.size());
+    PacketView view;
+    view.link_type = pcpp::LINKTYPE_ETHERNET;
+    for (size_t i = 0; i < flows_.size(); ++i) {
+        view.caplen = static_cast<uint32_t>(build_frame(flows_[i]));
+        view.len = flows_[i].frame_length;
+        view.data = frame_.data();
+        keys[i] = PacketParser<FlowKeyType>::parse_packet(view);
+    }
+
+    reset();
+    records.clear();
+    records.reserve(config_.packet_count);
+    PacketRecord<FlowKeyType> record;
+    while (emitted_ < config_.packet_count) {
+        const FlowSpec& flow = draw_packet(record.timestamp);
+        record.flow = keys[&flow - flows_.data()];
+        // parse_pcap 会丢弃提取结果为默认值的包，这里保持一致
+        if (record.flow == FlowKeyType()) {
+            continue;
+        }
+        record.length = flow.frame_length;
+        records.push_back(record);
+    }
+}
+
+// 显式实例化
+template void TraceGenerator::generate_records<OneTuple>(
+    std::vector<PacketRecord<OneTuple>>&);
+template void TraceGenerator::generate_records<TwoTuple>(
+    std::vector<PacketRecord<TwoTuple>>&);
+template void TraceGenerator::generate_records<FiveTuple>(
+    std::vector<PacketRecord<FiveTuple>>&);
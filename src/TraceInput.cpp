@@ -0,0 +1,259 @@
+#include "TraceInput.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#ifdef MEDIVH_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef MEDIVH_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+constexpr size_t READ_BUFFER_SIZE = 1 << 17;
+
+constexpr uint8_t GZIP_MAGIC[] = {0x1f, 0x8b};
+constexpr uint8_t ZSTD_MAGIC[] = {0x28, 0xb5, 0x2f, 0xfd};
+
+// 原始文件，带用户态缓冲，逐包的小块读取不再各自产生一次系统调用；
+// 开头已读出用于识别格式的字节作为缓冲区的初始内容
+class FileInput : public TraceInput {
+   public:
+    FileInput(int fd, const uint8_t* prefix, size_t prefix_size)
+        : fd_(fd),
+          buffer_(std::max(READ_BUFFER_SIZE, prefix_size)),
+          buffer_pos_(0),
+          buffer_end_(prefix_size) {
+        std::memcpy(buffer_.data(), prefix, prefix_size);
+    }
+
+    ~FileInput() override { ::close(fd_); }
+
+    size_t read(void* dst, size_t size) override {
+        uint8_t* out = static_cast<uint8_t*>(dst);
+        size_t done = 0;
+
+        while (done < size) {
+            if (buffer_pos_ == buffer_end_) {
+                // 剩余请求不小于缓冲区时直接读入目标，省去一次拷贝
+                if (size - done >= buffer_.size()) {
+                    size_t n = read_some(out + done, size - done);
+                    if (n == 0) {
+                        break;
+                    }
+                    done += n;
+                    continue;
+                }
+                buffer_pos_ = 0;
+                buffer_end_ = read_some(buffer_.data(), buffer_.size());
+                if (buffer_end_ == 0) {
+                    break;
+                }
+            }
+
+            size_t n = std::min(size - done, buffer_end_ - buffer_pos_);
+            std::memcpy(out + done, buffer_.data() + buffer_pos_, n);
+            buffer_pos_ += n;
+            done += n;
+        }
+        return done;
+    }
+
+   private:
+    int fd_;
+    std::vector<uint8_t> buffer_;
+    size_t buffer_pos_;
+    size_t buffer_end_;
+
+    // 读取至多 size 字节，文件结束时返回 0
+    size_t read_some(uint8_t* dst, size_t size) {
+        while (true) {
+            ssize_t n = ::read(fd_, dst, size);
+            if (n >= 0) {
+                return static_cast<size_t>(n);
+            }
+            if (errno != EINTR) {
+                throw std::runtime_error(std::string("Failed to read trace: ") +
+                                         std::strerror(errno));
+            }
+        }
+    }
+};
+
+#ifdef MEDIVH_HAVE_ZLIB
+// gzip 流，支持多个 member 首尾相接（如 cat a.gz b.gz）
+class GzipInput : public TraceInput {
+   public:
+    explicit GzipInput(std::unique_ptr<TraceInput> source)
+        : source_(std::move(source)), buffer_(READ_BUFFER_SIZE), eof_(false) {
+        std::memset(&stream_, 0, sizeof(stream_));
+        // 15 + 16：只接受 gzip 封装
+        if (inflateInit2(&stream_, 15 + 16) != Z_OK) {
+            throw std::runtime_error("Failed to initialize gzip decoder");
+        }
+    }
+
+    ~GzipInput() override { inflateEnd(&stream_); }
+
+    size_t read(void* dst, size_t size) override {
+        stream_.next_out = static_cast<Bytef*>(dst);
+        stream_.avail_out = static_cast<uInt>(size);
+
+        while (stream_.avail_out > 0) {
+            if (stream_.avail_in == 0) {
+                if (eof_) {
+                    break;
+                }
+                size_t n = source_->read(buffer_.data(), buffer_.size());
+                if (n == 0) {
+                    eof_ = true;
+                    break;
+                }
+                stream_.next_in = buffer_.data();
+                stream_.avail_in = static_cast<uInt>(n);
+            }
+
+            int ret = inflate(&stream_, Z_NO_FLUSH);
+            if (ret == Z_STREAM_END) {
+                // 一个 member 结束，后面可能还有下一个
+                inflateReset(&stream_);
+            } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                throw std::runtime_error("Corrupted gzip trace");
+            }
+        }
+        return size - stream_.avail_out;
+    }
+
+   private:
+    std::unique_ptr<TraceInput> source_;
+    std::vector<Bytef> buffer_;
+    z_stream stream_;
+    bool eof_;
+};
+#endif
+
+#ifdef MEDIVH_HAVE_ZSTD
+class ZstdInput : public TraceInput {
+   public:
+    explicit ZstdInput(std::unique_ptr<TraceInput> source)
+        : source_(std::move(source)),
+          stream_(ZSTD_createDStream()),
+          buffer_(ZSTD_DStreamInSize()),
+          input_{buffer_.data(), 0, 0},
+          eof_(false) {
+        if (!stream_ || ZSTD_isError(ZSTD_initDStream(stream_))) {
+            ZSTD_freeDStream(stream_);
+            throw std::runtime_error("Failed to initialize zstd decoder");
+        }
+    }
+
+    ~ZstdInput() override { ZSTD_freeDStream(stream_); }
+
+    size_t read(void* dst, size_t size) override {
+        ZSTD_outBuffer output = {dst, size, 0};
+
+        while (output.pos < output.size) {
+            if (input_.pos == input_.size) {
+                if (eof_) {
+                    break;
+                }
+                size_t n = source_->read(buffer_.data(), buffer_.size());
+                if (n == 0) {
+                    eof_ = true;
+                    break;
+                }
+                input_.size = n;
+                input_.pos = 0;
+            }
+
+            size_t ret = ZSTD_decompressStream(stream_, &output, &input_);
+            if (ZSTD_isError(ret)) {
+                throw std::runtime_error(std::string("Corrupted zstd trace: ") +
+                                         ZSTD_getErrorName(ret));
+            }
+        }
+        return output.pos;
+    }
+
+   private:
+    std::unique_ptr<TraceInput> source_;
+    ZSTD_DStream* stream_;
+    std::vector<uint8_t> buffer_;
+    ZSTD_inBuffer input_;
+    bool eof_;
+};
+#endif
+
+bool has_magic(const uint8_t* data,
+               size_t size,
+               const uint8_t* magic,
+               size_t magic_size) {
+    return size >= magic_size && std::memcmp(data, magic, magic_size) == 0;
+}
+
+}  // namespace
+
+bool TraceInput::skip(size_t size) {
+    uint8_t scratch[4096];
+    while (size > 0) {
+        size_t chunk = std::min(size, sizeof(scratch));
+        if (read(scratch, chunk) != chunk) {
+            return false;
+        }
+        size -= chunk;
+    }
+    return true;
+}
+
+std::unique_ptr<TraceInput> TraceInput::open(const std::string& filename) {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    // 读出开头几个字节识别压缩格式，再交还给 FileInput
+    uint8_t prefix[sizeof(ZSTD_MAGIC)];
+    size_t prefix_size = 0;
+    while (prefix_size < sizeof(prefix)) {
+        ssize_t n =
+            ::read(fd, prefix + prefix_size, sizeof(prefix) - prefix_size);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        prefix_size += static_cast<size_t>(n);
+    }
+
+    std::unique_ptr<TraceInput> file(new FileInput(fd, prefix, prefix_size));
+
+    if (has_magic(prefix, prefix_size, GZIP_MAGIC, sizeof(GZIP_MAGIC))) {
+#ifdef MEDIVH_HAVE_ZLIB
+        return std::unique_ptr<TraceInput>(new GzipInput(std::move(file)));
+#else
+        throw std::runtime_error("gzip trace requires zlib support: " +
+                                 filename);
+#endif
+    }
+
+    if (has_magic(prefix, prefix_size, ZSTD_MAGIC, sizeof(ZSTD_MAGIC))) {
+#ifdef MEDIVH_HAVE_ZSTD
+        return std::unique_ptr<TraceInput>(new ZstdInput(std::move(file)));
+#else
+        throw std::runtime_error("zstd trace requires libzstd support: " +
+                                 filename);
+#endif
+    }
+
+    return file;
+}
@@ -0,0 +1,188 @@
+// trace 回放工具：把 pcap / pcapng 中的以太网帧经 AF_PACKET 原始套接字
+// 原样发到指定网卡，配合 LiveSource 在 lo 或 veth 对上做端到端检查
+// 用法: medivh_replay -i <网卡> [选项] <trace>，选项见 print_usage
+// 需要 CAP_NET_RAW 权限
+
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <linux/if_packet.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "CommandLine.h"
+#include "PacketParser.h"
+
+namespace {
+
+void print_usage(const char* program) {
+    std::fprintf(
+        stderr,
+        "用法: %s -i <网卡> [选项] <trace>\n"
+        "  -i, --interface <网卡>  发送用的网卡，如 lo 或 veth 对的一端\n"
+        "  -r, --rate <包每秒>     限速发送，默认 0 表示不限速\n"
+        "  -l, --loops <次数>      重复回放整个 trace 的次数，默认 1\n"
+        "只发送以太网链路层的包；截断保存的包按捕获长度发送\n",
+        program);
+}
+
+struct ReplayCounters {
+    uint64_t sent = 0;
+    uint64_t bytes = 0;
+    uint64_t skipped = 0;  // 非以太网链路层或短于以太网头的包
+};
+
+class RawSender {
+   public:
+    explicit RawSender(const std::string& interface) : fd_(-1) {
+        unsigned int ifindex = if_nametoindex(interface.c_str());
+        if (ifindex == 0) {
+            throw std::runtime_error("网卡不存在: " + interface);
+        }
+        fd_ = ::socket(AF_PACKET, SOCK_RAW, 0);
+        if (fd_ < 0) {
+            throw std::runtime_error(
+                std::string("无法创建原始套接字（需要 CAP_NET_RAW）: ") +
+                std::strerror(errno));
+        }
+        std::memset(&addr_, 0, sizeof(addr_));
+        addr_.sll_family = AF_PACKET;
+        addr_.sll_ifindex = static_cast<int>(ifindex);
+        addr_.sll_halen = ETH_ALEN;
+    }
+
+    ~RawSender() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    RawSender(const RawSender&) = delete;
+    RawSender& operator=(const RawSender&) = delete;
+
+    void send(const uint8_t* frame, size_t size) {
+        while (::sendto(fd_, frame, size, 0,
+                        reinterpret_cast<const struct sockaddr*>(&addr_),
+                        sizeof(addr_)) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // 发送队列满时稍后重试，其他错误直接报告
+            if (errno == ENOBUFS || errno == EAGAIN) {
+                std::this_thread::sleep_for(std::chrono::microseconds{50});
+                continue;
+            }
+            throw std::runtime_error(std::string("发送失败: ") +
+                                     std::strerror(errno));
+        }
+    }
+
+   private:
+    int fd_;
+    struct sockaddr_ll addr_;
+};
+
+void replay_once(const std::string& trace,
+                 RawSender& sender,
+                 uint64_t rate,
+                 std::chrono::steady_clock::time_point start,
+                 ReplayCounters& counters) {
+    PcapReader reader(trace);
+    if (!reader.open()) {
+        throw std::runtime_error("无法打开 trace: " + trace);
+    }
+
+    PacketView view;
+    while (reader.get_next_packet(view)) {
+        if (view.link_type != pcpp::LINKTYPE_ETHERNET ||
+            view.caplen < ETH_HLEN) {
+            ++counters.skipped;
+            continue;
+        }
+        if (rate > 0) {
+            // 按发送序号计算应发时刻，睡眠误差不会累积
+            auto due = start + std::chrono::nanoseconds{
+                                   counters.sent * 1000000000ull / rate};
+            std::this_thread::sleep_until(due);
+        }
+        sender.send(view.data, view.caplen);
+        ++counters.sent;
+        counters.bytes += view.caplen;
+    }
+    reader.close();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    static const option LONG_OPTIONS[] = {
+        {"interface", required_argument, nullptr, 'i'},
+        {"rate", required_argument, nullptr, 'r'},
+        {"loops", required_argument, nullptr, 'l'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0},
+    };
+
+    std::string interface;
+    uint64_t rate = 0;
+    uint64_t loops = 1;
+
+    try {
+        int opt;
+        while ((opt = getopt_long(argc, argv, "i:r:l:h", LONG_OPTIONS,
+                                  nullptr)) != -1) {
+            switch (opt) {
+                case 'i':
+                    interface = optarg;
+                    break;
+                case 'r':
+                    rate = parse_unsigned(optarg, UINT32_MAX);
+                    break;
+                case 'l':
+                    loops = parse_unsigned(optarg, UINT32_MAX);
+                    break;
+                case 'h':
+                    print_usage(argv[0]);
+                    return 0;
+                default:
+                    print_usage(argv[0]);
+                    return 1;
+            }
+        }
+        if (interface.empty() || optind + 1 != argc) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        std::string trace = argv[optind];
+
+        RawSender sender(interface);
+        ReplayCounters counters;
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t loop = 0; loop < loops; ++loop) {
+            replay_once(trace, sender, rate, start, counters);
+        }
+        double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+
+        std::printf("已发送 %llu 个包、%llu 字节，跳过 %llu 个，用时 %.3f 秒\n",
+                    static_cast<unsigned long long>(counters.sent),
+                    static_cast<unsigned long long>(counters.bytes),
+                    static_cast<unsigned long long>(counters.skipped),
+                    seconds);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "错误: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}